@@ -0,0 +1,73 @@
+# Checks that --report json does not change the timing it reports, run by ctest with cmake -P.
+#
+# Each tool runs RUNS times with the plain output and RUNS times with the JSON report over the
+# same generated dataset. The fastest ns of each mode must agree within TOLERANCE_PERCENT of the larger
+# plus SLACK_NS, which absorbs scheduler noise on a result well under a millisecond.
+
+if(NOT RUNS)
+    set(RUNS 9)
+endif()
+set(TOLERANCE_PERCENT 25)
+set(SLACK_NS 50000)
+set(DATASET ${BIN_DIR}/report_timing.csv)
+
+execute_process(COMMAND ${BIN_DIR}/speedy_gen -n 10 -k 6 --seed 7 --out ${DATASET}
+    OUTPUT_QUIET RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "speedy_gen failed: ${status}")
+endif()
+
+function(fastest_ns tool report out)
+    set(best "")
+    foreach(run RANGE 1 ${RUNS})
+        if(report)
+            execute_process(COMMAND ${BIN_DIR}/${tool} -n 10 -k 6 --csv ${DATASET} --report json
+                OUTPUT_VARIABLE output RESULT_VARIABLE status)
+            string(REGEX MATCH "\"ns\": ([0-9.e+]+)" match "${output}")
+        else()
+            execute_process(COMMAND ${BIN_DIR}/${tool} -n 10 -k 6 --csv ${DATASET}
+                OUTPUT_VARIABLE output RESULT_VARIABLE status)
+            string(REGEX MATCH "([0-9.e+]+) ns" match "${output}")
+        endif()
+        if(NOT status EQUAL 0 OR NOT match)
+            message(FATAL_ERROR "${tool} failed or printed no time: ${output}")
+        endif()
+        # Times print as integers or in scientific notation; math(EXPR) only takes integers.
+        set(ns ${CMAKE_MATCH_1})
+        if(ns MATCHES "e")
+            string(REGEX REPLACE "^([0-9]+)\\.?([0-9]*)e\\+0*([0-9]+)$" "\\1;\\2;\\3" parts "${ns}")
+            list(GET parts 0 whole)
+            list(GET parts 1 fraction)
+            list(GET parts 2 exponent)
+            string(LENGTH "${fraction}" digits)
+            math(EXPR pad "${exponent} - ${digits}")
+            set(ns "${whole}${fraction}")
+            foreach(zero RANGE 1 ${pad})
+                string(APPEND ns "0")
+            endforeach()
+        else()
+            string(REGEX REPLACE "\\..*" "" ns "${ns}")
+        endif()
+        if(best STREQUAL "" OR ns LESS best)
+            set(best ${ns})
+        endif()
+    endforeach()
+    set(${out} ${best} PARENT_SCOPE)
+endfunction()
+
+foreach(tool ${TOOLS})
+    fastest_ns(${tool} OFF plain)
+    fastest_ns(${tool} ON reported)
+    if(plain GREATER reported)
+        set(larger ${plain})
+        math(EXPR difference "${plain} - ${reported}")
+    else()
+        set(larger ${reported})
+        math(EXPR difference "${reported} - ${plain}")
+    endif()
+    math(EXPR allowed "${larger} * ${TOLERANCE_PERCENT} / 100 + ${SLACK_NS}")
+    message(STATUS "${tool}: plain ${plain} ns, --report json ${reported} ns")
+    if(difference GREATER allowed)
+        message(FATAL_ERROR "${tool}: --report json reports ${reported} ns against ${plain} ns without it")
+    endif()
+endforeach()
@@ -0,0 +1,57 @@
+# Two-stage profile-guided build, run by the pgo target with cmake -P.
+#
+# Both stages build in the same directory so object paths, which GCC keys profiles on, match.
+# Training covers the kernel microbenchmarks, the min/max tools end to end with batch reversal,
+# libspeedy through pgo_train, and every other tool the build produces, over a generated
+# dataset. Sources that training never runs are left without a profile and GCC warns about them.
+
+set(PROFILE_DIR ${BINARY_DIR}/profiles)
+set(TRAINING_CSV ${BINARY_DIR}/training.csv)
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        string(REPLACE ";" " " command "${ARGN}")
+        message(FATAL_ERROR "${command} failed: ${status}")
+    endif()
+endfunction()
+
+function(build stage)
+    message(STATUS "PGO: ${stage} build in ${BINARY_DIR}")
+    run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BINARY_DIR} -G ${GENERATOR}
+        -DCMAKE_CXX_COMPILER=${CXX_COMPILER} -DCMAKE_BUILD_TYPE=Release
+        -DSPEEDY_MARCH=${MARCH} -DSPEEDY_LTO=${LTO}
+        -DSPEEDY_PGO=${stage} -DSPEEDY_PGO_DIR=${PROFILE_DIR})
+    run(${CMAKE_COMMAND} --build ${BINARY_DIR})
+endfunction()
+
+file(REMOVE_RECURSE ${PROFILE_DIR})
+build(GENERATE)
+
+message(STATUS "PGO: training")
+run(${BINARY_DIR}/benchmark_micro --min-time 0.02 --repetitions 1 --max-bytes 33554432)
+run(${BINARY_DIR}/speedy_gen -n 10 -k 6 --out ${TRAINING_CSV})
+foreach(tool speedy_min speedy_max)
+    run(${BINARY_DIR}/${tool} -n 10 -k 6 --csv ${TRAINING_CSV} --batch-out ${BINARY_DIR}/training.out)
+    run(${BINARY_DIR}/${tool} -n 10 -k 6 --csv ${TRAINING_CSV} --batch-out ${BINARY_DIR}/training.out --permutations)
+endforeach()
+run(${BINARY_DIR}/pgo_train -n 10 -k 6 --csv ${TRAINING_CSV})
+run(${BINARY_DIR}/speedy_encode -n 10 -k 6 --csv ${TRAINING_CSV} --out ${BINARY_DIR}/training --layer 1)
+run(${BINARY_DIR}/pgo_train -n 10 -k 6 --csv ${BINARY_DIR}/training.layer1.bin --rounds 1)
+run(${BINARY_DIR}/benchmark_specialized --count 100000)
+run(${BINARY_DIR}/test_reference)
+if(EXISTS ${BINARY_DIR}/speedy_x86)
+    run(${BINARY_DIR}/speedy_x86 -n 10 -k 6 --csv ${TRAINING_CSV})
+endif()
+if(EXISTS ${BINARY_DIR}/speedy_serve)
+    run(sh ${SOURCE_DIR}/cmake/pgo_serve.sh ${BINARY_DIR} ${TRAINING_CSV} ${BINARY_DIR}/training.sock)
+endif()
+
+if(CXX_COMPILER_ID MATCHES "Clang")
+    find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+    file(GLOB raw_profiles ${PROFILE_DIR}/*.profraw)
+    run(${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/default.profdata ${raw_profiles})
+endif()
+
+build(USE)
+message(STATUS "PGO: optimized binaries are in ${BINARY_DIR}")
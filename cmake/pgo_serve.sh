@@ -0,0 +1,38 @@
+#!/bin/sh
+# PGO training for the query daemon, run by pgo.cmake: starts speedy_serve in the background,
+# sends it a burst of every query, then stops it with SIGTERM so it exits normally and writes
+# its profile.
+#
+# pgo_serve.sh <bin-dir> <dataset> <socket>
+
+bin=$1
+dataset=$2
+socket=$3
+
+"$bin/speedy_serve" -n 10 -k 6 --dataset "t=$dataset" --socket "$socket" > /dev/null &
+server=$!
+trap 'kill -TERM $server 2> /dev/null' EXIT
+
+attempt=0
+while [ ! -S "$socket" ]; do
+    attempt=$((attempt + 1))
+    if [ $attempt -gt 600 ] || ! kill -0 $server 2> /dev/null; then
+        echo "speedy_serve did not start" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+query() {
+    "$bin/speedy_query" --socket "$socket" --dataset t --repeat 2000 "$@" > /dev/null
+}
+
+query --op min && query --op max && query --op rank --value 500000 &&
+    query --op top-k --limit 16 --largest && query --op range --low 1000 --high 90000 --limit 32 &&
+    "$bin/speedy_query" --socket "$socket" --op list > /dev/null
+status=$?
+
+trap - EXIT
+kill -TERM $server
+wait $server || status=1
+exit $status
@@ -0,0 +1,194 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_BATCH_HPP
+#define SPEEDY_BATCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPEEDY_HAVE_X86_SIMD 1
+#endif
+
+#include "speedy/cache.hpp"
+#include "speedy/layers.hpp"
+#include "speedy/packed.hpp"
+#include "speedy/parallel.hpp"
+#include "speedy/permutation.hpp"
+#include "speedy/timeline.hpp"
+
+namespace speedy {
+
+namespace detail {
+
+// There are no k-permutations of n when k > n, so nothing defined could fill the rows. Checked
+// before any work is handed to threads, where the exception could not be caught.
+inline void require_permutation_shape(int n, int k) {
+    if (k < 0 || k > n) {
+        throw std::out_of_range("no " + std::to_string(k) + "-permutations of " + std::to_string(n) + " elements");
+    }
+}
+
+// decode_layer in pure 32-bit integer arithmetic. With value = 2a + b and c = 1 + depth = 2e + f,
+// trunc((value - c) / 2) = a - e - (b < f) + (value < c && b != f), which never overflows.
+inline int decode_layer_int(int value, int layer_depth) {
+    int c = 1 + layer_depth;
+    int a = value >> 1;
+    int b = value & 1;
+    int e = c >> 1;
+    int f = c & 1;
+    return a - e - (b < f) + ((value < c) & (b != f));
+}
+
+inline void reverse_chunk_scalar(const int* values, std::size_t count, int layer_depth, int* out) {
+    for (std::size_t i = 0; i < count; ++i) {
+        int value = values[i];
+        for (int depth = layer_depth; depth > 0; --depth) {
+            value = decode_layer_int(value, depth);
+        }
+        out[i] = value;
+    }
+}
+
+#ifdef SPEEDY_HAVE_X86_SIMD
+__attribute__((target("avx2")))
+inline void reverse_chunk_avx2(const int* values, std::size_t count, int layer_depth, int* out) {
+    const __m256i one = _mm256_set1_epi32(1);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        for (int depth = layer_depth; depth > 0; --depth) {
+            int c = 1 + depth;
+            __m256i half = _mm256_sub_epi32(_mm256_srai_epi32(value, 1), _mm256_set1_epi32(c >> 1));
+            __m256i odd = _mm256_and_si256(value, one);
+            __m256i below = _mm256_cmpgt_epi32(_mm256_set1_epi32(c), value);
+            if ((c & 1) == 0) {
+                value = _mm256_add_epi32(half, _mm256_and_si256(below, odd));
+            } else {
+                value = _mm256_sub_epi32(half, _mm256_andnot_si256(below, _mm256_xor_si256(odd, one)));
+            }
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), value);
+    }
+    reverse_chunk_scalar(values + i, count - i, layer_depth, out + i);
+}
+#endif
+
+inline void reverse_chunk(const int* values, std::size_t count, int layer_depth, int* out) {
+#ifdef SPEEDY_HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        reverse_chunk_avx2(values, count, layer_depth, out);
+        return;
+    }
+#endif
+    reverse_chunk_scalar(values, count, layer_depth, out);
+}
+
+}  // namespace detail
+
+// Names the lane kernel reverse_batch uses on this CPU, for reports.
+inline const char* batch_kernel() {
+#ifdef SPEEDY_HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+// Below this a chunk is cheaper to run inline than to hand to a thread.
+constexpr std::size_t kBatchMinChunk = 1 << 14;
+
+// Reverse-engineers count encoded values from layer_depth down to layer 0, writing the layer-0
+// index of values[i] to out[i]. Lanes run in AVX2 registers when the CPU has them and chunks
+// are split across threads (0 means one per hardware thread).
+inline void reverse_batch(const int* values, std::size_t count, int layer_depth, int* out, unsigned threads = 0) {
+    parallel_for(count, threads, kBatchMinChunk, [=](std::size_t begin, std::size_t end) {
+        TimelineSpan span("layer walk", "reverse");
+        detail::reverse_chunk(values + begin, end - begin, layer_depth, out + begin);
+    });
+}
+
+// As reverse_batch, then unranks each index into k consecutive ints of out. Indices wrap modulo
+// P(n, k); throws std::out_of_range when k > n.
+inline void reverse_batch_permutations(int n, int k, const int* values, std::size_t count, int layer_depth, int* out,
+                                       unsigned threads = 0) {
+    detail::require_permutation_shape(n, k);
+    parallel_for(count, threads, kBatchMinChunk, [=](std::size_t begin, std::size_t end) {
+        std::vector<int> indices(end - begin);
+        {
+            TimelineSpan span("layer walk", "reverse");
+            detail::reverse_chunk(values + begin, end - begin, layer_depth, indices.data());
+        }
+        TimelineSpan span("unrank", "reverse");
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            ithPermutation(n, k, indices[i], out + (begin + i) * k);
+        }
+    });
+}
+
+// As reverse_batch_permutations, packing each row into out (resized to count rows) instead of
+// k full ints. out must be an arena for the same n and k. Throws std::out_of_range, leaving out
+// untouched, when k > n.
+inline void reverse_batch_permutations(const int* values, std::size_t count, int layer_depth, PermutationArena& out,
+                                       unsigned threads = 0) {
+    int n = out.n();
+    int k = out.k();
+    detail::require_permutation_shape(n, k);
+    out.resize(count);
+    parallel_for(count, threads, kBatchMinChunk, [&](std::size_t begin, std::size_t end) {
+        std::vector<int> indices(end - begin);
+        std::vector<int> row(k);
+        {
+            TimelineSpan span("layer walk", "reverse");
+            detail::reverse_chunk(values + begin, end - begin, layer_depth, indices.data());
+        }
+        TimelineSpan span("unrank", "reverse");
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            ithPermutation(n, k, indices[i], row.data());
+            out.set(begin + i, row.data());
+        }
+    });
+}
+
+// As reverse_batch_permutations for workloads with many repeated values: layer-0 indices are
+// memoized per (value, depth) and digits per (n, k, i). Rows wider than
+// kCachedPermutationWidth bypass the digit cache. Throws std::out_of_range when k > n.
+inline void reverse_batch_permutations(int n, int k, const int* values, std::size_t count, int layer_depth, int* out,
+                                       LayerCache& layers, PermutationCache& permutations, unsigned threads = 0) {
+    detail::require_permutation_shape(n, k);
+    LayerPlan plan(layer_depth);
+    parallel_for(count, threads, kBatchMinChunk, [&, out](std::size_t begin, std::size_t end) {
+        TimelineSpan span("cached walk", "reverse");
+        for (std::size_t i = begin; i < end; ++i) {
+            int index = layers.get_or_compute(LayerKey{values[i], layer_depth},
+                                              [&] { return static_cast<int>(plan.apply(values[i])); });
+            int* row = out + i * k;
+            if (k > kCachedPermutationWidth) {
+                ithPermutation(n, k, index, row);
+                continue;
+            }
+            CachedPermutation digits = permutations.get_or_compute(PermutationKey{n, k, index}, [&] {
+                CachedPermutation computed{};
+                ithPermutation(n, k, index, computed.data());
+                return computed;
+            });
+            std::copy(digits.begin(), digits.begin() + k, row);
+        }
+    });
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_BATCH_HPP
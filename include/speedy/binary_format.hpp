@@ -0,0 +1,168 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_BINARY_FORMAT_HPP
+#define SPEEDY_BINARY_FORMAT_HPP
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "speedy/exact.hpp"
+
+namespace speedy {
+
+// A layer file is this header followed by count little-endian unsigned words of word_bytes
+// each: 8 for uint64_t, 16 for unsigned __int128, ExactWide::kBits / 8 for the widest tier.
+struct BinaryHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t word_bytes;
+    int32_t layer_depth;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(BinaryHeader) == 24, "BinaryHeader is written as raw bytes");
+
+constexpr char kBinaryMagic[4] = {'S', 'P', 'D', 'Y'};
+constexpr uint16_t kBinaryVersion = 1;
+
+template <typename Word>
+constexpr uint16_t word_bytes() {
+    if constexpr (std::is_same_v<Word, uint64_t>) {
+        return 8;
+    } else if constexpr (std::is_same_v<Word, unsigned __int128>) {
+        return 16;
+    } else {
+        return Word::kBits / 8;
+    }
+}
+
+// Appends words to buffer as little-endian bytes. Assumes a little-endian host, like the rest
+// of the x86-oriented tooling.
+template <typename Word>
+void append_words(const Word* words, std::size_t count, std::vector<char>& buffer) {
+    std::size_t offset = buffer.size();
+    buffer.resize(offset + count * word_bytes<Word>());
+    if constexpr (std::is_same_v<Word, uint64_t> || std::is_same_v<Word, unsigned __int128>) {
+        std::memcpy(buffer.data() + offset, words, count * sizeof(Word));
+    } else {
+        for (std::size_t i = 0; i < count; ++i) {
+            for (int limb = 0; limb < Word::kBits / 64; ++limb) {
+                uint64_t value = words[i].limb(limb);
+                std::memcpy(buffer.data() + offset, &value, sizeof(value));
+                offset += sizeof(value);
+            }
+        }
+    }
+}
+
+// Streams one layer to disk; the count in the header is patched on close.
+class LayerFileWriter {
+public:
+    LayerFileWriter(const std::string& path, uint16_t word_bytes, int layer_depth) : path_(path) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open " + path + " for writing");
+        }
+        std::memcpy(header_.magic, kBinaryMagic, sizeof(kBinaryMagic));
+        header_.version = kBinaryVersion;
+        header_.word_bytes = word_bytes;
+        header_.layer_depth = layer_depth;
+        write(&header_, sizeof(header_));
+    }
+
+    LayerFileWriter(const LayerFileWriter&) = delete;
+    LayerFileWriter& operator=(const LayerFileWriter&) = delete;
+
+    ~LayerFileWriter() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    void append(const std::vector<char>& bytes) {
+        write(bytes.data(), bytes.size());
+        header_.count += bytes.size() / header_.word_bytes;
+    }
+
+    void close() {
+        if (std::fseek(file_, 0, SEEK_SET) != 0) {
+            throw std::runtime_error("cannot seek in " + path_);
+        }
+        write(&header_, sizeof(header_));
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+private:
+    void write(const void* data, std::size_t size) {
+        if (std::fwrite(data, 1, size, file_) != size) {
+            throw std::runtime_error("short write to " + path_);
+        }
+    }
+
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    BinaryHeader header_{};
+};
+
+// Reads the words of an 8-byte-word layer file.
+inline std::vector<uint64_t> load_words_from_binary(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    BinaryHeader header{};
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, kBinaryMagic, 4) != 0 ||
+        header.version != kBinaryVersion) {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a speedy layer file");
+    }
+    if (header.word_bytes != 8) {
+        std::fclose(file);
+        throw std::runtime_error(path + " holds " + std::to_string(header.word_bytes * 8) +
+                                 "-bit words; the reverse path reads 64-bit layer files");
+    }
+
+    std::vector<uint64_t> words(header.count);
+    std::size_t read = std::fread(words.data(), sizeof(uint64_t), words.size(), file);
+    std::fclose(file);
+    if (read != words.size()) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    return words;
+}
+
+// Narrows layer-file words to the int values the reverse path works on; path names the file
+// in errors.
+inline std::vector<int> values_from_words(const std::vector<uint64_t>& words, const std::string& path) {
+    std::vector<int> values(words.size());
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        if (words[i] > static_cast<uint64_t>(INT_MAX)) {
+            throw std::runtime_error(path + " holds " + std::to_string(words[i]) + ", wider than the reverse path's int");
+        }
+        values[i] = static_cast<int>(words[i]);
+    }
+    return values;
+}
+
+inline std::vector<int> load_values_from_binary(const std::string& path) {
+    return values_from_words(load_words_from_binary(path), path);
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_BINARY_FORMAT_HPP
@@ -0,0 +1,227 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_CACHE_HPP
+#define SPEEDY_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace speedy {
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+// Fixed-capacity concurrent memo table. Keys hash to a shard and then to an 8-way bucket;
+// readers never lock (each slot is a seqlock over atomic words) while writers take the shard
+// mutex and evict with a CLOCK hand per bucket. Key and Value must be trivially copyable and
+// Key must have no padding, since keys are compared bytewise.
+template <typename Key, typename Value>
+class ClockCache {
+public:
+    static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+                  "cached keys and values are copied as raw words");
+
+    explicit ClockCache(std::size_t capacity, std::size_t shards = 16) {
+        shards = std::max<std::size_t>(1, shards);
+        std::size_t buckets = std::max<std::size_t>(1, (capacity + shards * kWays - 1) / (shards * kWays));
+        shards_.reserve(shards);
+        for (std::size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>(buckets));
+        }
+    }
+
+    std::size_t capacity() const { return shards_.size() * shards_[0]->buckets.size() * kWays; }
+
+    std::optional<Value> find(const Key& key) {
+        Words words = pack_key(key);
+        uint64_t hash = hash_words(words);
+        Shard& shard = shard_for(hash);
+        Bucket& bucket = shard.buckets[(hash >> 8) % shard.buckets.size()];
+
+        for (Slot& slot : bucket.slots) {
+            Words copy;
+            if (read_slot(slot, copy) && std::memcmp(copy.data(), words.data(), sizeof(Key)) == 0) {
+                if (slot.referenced.load(std::memory_order_relaxed) == 0) {
+                    slot.referenced.store(1, std::memory_order_relaxed);
+                }
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                Value value;
+                std::memcpy(&value, reinterpret_cast<const char*>(copy.data()) + kValueOffset, sizeof(Value));
+                return value;
+            }
+        }
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    void insert(const Key& key, const Value& value) {
+        Words words = pack_key(key);
+        uint64_t hash = hash_words(words);
+        std::memcpy(reinterpret_cast<char*>(words.data()) + kValueOffset, &value, sizeof(Value));
+        Shard& shard = shard_for(hash);
+        Bucket& bucket = shard.buckets[(hash >> 8) % shard.buckets.size()];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Slot* target = nullptr;
+        for (Slot& slot : bucket.slots) {
+            uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            if (sequence == 0) {
+                target = target != nullptr ? target : &slot;
+            } else if (std::memcmp(load_words(slot).data(), words.data(), sizeof(Key)) == 0) {
+                target = &slot;
+                break;
+            }
+        }
+        if (target == nullptr) {
+            // Second chance: clear reference bits until the hand finds a cold way.
+            while (bucket.slots[bucket.hand].referenced.exchange(0, std::memory_order_relaxed) != 0) {
+                bucket.hand = (bucket.hand + 1) % kWays;
+            }
+            target = &bucket.slots[bucket.hand];
+            bucket.hand = (bucket.hand + 1) % kWays;
+            shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        write_slot(*target, words);
+    }
+
+    template <typename Compute>
+    Value get_or_compute(const Key& key, Compute&& compute) {
+        if (auto cached = find(key)) {
+            return *cached;
+        }
+        Value value = compute();
+        insert(key, value);
+        return value;
+    }
+
+    CacheStats stats() const {
+        CacheStats total;
+        for (const auto& shard : shards_) {
+            total.hits += shard->hits.load(std::memory_order_relaxed);
+            total.misses += shard->misses.load(std::memory_order_relaxed);
+            total.evictions += shard->evictions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static constexpr std::size_t kWays = 8;
+    static constexpr std::size_t kValueOffset = sizeof(Key);
+    static constexpr std::size_t kWords = (sizeof(Key) + sizeof(Value) + 7) / 8;
+
+    using Words = std::array<uint64_t, kWords>;
+
+    struct Slot {
+        // 0 means empty; odd while a writer is mid-update.
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint8_t> referenced{0};
+        std::array<std::atomic<uint64_t>, kWords> words{};
+    };
+
+    struct Bucket {
+        std::array<Slot, kWays> slots;
+        std::size_t hand = 0;
+    };
+
+    struct Shard {
+        explicit Shard(std::size_t count) : buckets(count) {}
+
+        std::mutex mutex;
+        std::vector<Bucket> buckets;
+        alignas(64) std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+    };
+
+    static Words pack_key(const Key& key) {
+        Words words{};
+        std::memcpy(words.data(), &key, sizeof(Key));
+        return words;
+    }
+
+    static uint64_t hash_words(const Words& words) {
+        uint64_t hash = 0x9e3779b97f4a7c15ull;
+        for (std::size_t i = 0; i < (sizeof(Key) + 7) / 8; ++i) {
+            hash ^= words[i];
+            hash *= 0xbf58476d1ce4e5b9ull;
+            hash ^= hash >> 31;
+        }
+        return hash;
+    }
+
+    static Words load_words(const Slot& slot) {
+        Words copy;
+        for (std::size_t i = 0; i < kWords; ++i) {
+            copy[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        return copy;
+    }
+
+    static bool read_slot(const Slot& slot, Words& copy) {
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before == 0 || (before & 1) != 0) {
+            return false;
+        }
+        copy = load_words(slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    static void write_slot(Slot& slot, const Words& words) {
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        // Skip 0 on wrap-around so a filled slot never reads as empty.
+        uint32_t next = sequence + 2 == 0 ? 2 : sequence + 2;
+        slot.sequence.store(next, std::memory_order_release);
+        slot.referenced.store(1, std::memory_order_relaxed);
+    }
+
+    Shard& shard_for(uint64_t hash) { return *shards_[hash % shards_.size()]; }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// (value, depth) -> layer-0 index.
+struct LayerKey {
+    int64_t value;
+    int64_t layer_depth;
+};
+
+// (n, k, i) -> the unranked digits, for k up to kCachedPermutationWidth.
+struct PermutationKey {
+    int32_t n;
+    int32_t k;
+    int64_t i;
+};
+
+constexpr int kCachedPermutationWidth = 16;
+using CachedPermutation = std::array<int, kCachedPermutationWidth>;
+
+using LayerCache = ClockCache<LayerKey, int>;
+using PermutationCache = ClockCache<PermutationKey, CachedPermutation>;
+
+}  // namespace speedy
+
+#endif  // SPEEDY_CACHE_HPP
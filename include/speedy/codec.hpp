@@ -0,0 +1,71 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_CODEC_HPP
+#define SPEEDY_CODEC_HPP
+
+#include <cmath>
+
+namespace speedy {
+
+// The floating-point layer transforms: encode(Y, D) = 2^D * (Y + D / 2) and its inverse.
+inline double encode(double Y, int D) {
+    return std::pow(2, D) * (Y + D / 2.0);
+}
+
+inline double decode(double X, int D) {
+    return X / std::pow(2, D) - D / 2.0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SPEEDY_HAVE_X87 1
+
+// The same transforms in x87 assembly, as speedy_x86 runs them.
+inline double encode_x87(double Y, int D) {
+    double result;
+    asm volatile(
+        "fldl2e\n\t"        // Load log2(e) to stack
+        "fmulp\n\t"         // Multiply ST(1) with ST(0), store result in ST(1)
+        "fild %1\n\t"       // Load int D
+        "faddp\n\t"         // Add ST(1) to ST(0)
+        "fyl2x\n\t"         // Compute ST(1) * log2(ST(0))
+        "fld1\n\t"          // Load constant 1
+        "fadd\n\t"          // Add ST(1) to ST(0)
+        "fscale\n\t"        // Scale by power of 2
+        "fstp %0"           // Store result in 'result'
+        : "=m"(result)
+        : "m"(D), "m"(Y)
+    );
+    return result;
+}
+
+inline double decode_x87(double X, int D) {
+    double result;
+    asm volatile(
+        "fldl2e\n\t"        // Load log2(e) to stack
+        "fild %1\n\t"       // Load int D
+        "fmulp\n\t"         // Multiply ST(1) with ST(0), store result in ST(1)
+        "fyl2x\n\t"         // Compute ST(1) * log2(ST(0))
+        "fld1\n\t"          // Load constant 1
+        "fadd\n\t"          // Add ST(1) to ST(0)
+        "fscale\n\t"        // Scale by power of 2
+        "fld %2\n\t"        // Load double X
+        "fdivp\n\t"         // Divide X by the result in ST(0)
+        "fild %1\n\t"       // Load int D
+        "fsubp\n\t"         // Subtract D/2 from the result
+        "fstp %0"           // Store result in 'result'
+        : "=m"(result)
+        : "m"(D), "m"(X)
+    );
+    return result;
+}
+#endif
+
+}  // namespace speedy
+
+#endif  // SPEEDY_CODEC_HPP
@@ -0,0 +1,112 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_CSV_HPP
+#define SPEEDY_CSV_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "speedy/parallel.hpp"
+#include "speedy/timeline.hpp"
+
+namespace speedy {
+
+// Reads a whole file into memory.
+inline std::string read_file(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::string text;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        long size = std::ftell(file);
+        if (size > 0) {
+            text.reserve(static_cast<std::size_t>(size));
+        }
+        std::rewind(file);
+    }
+    char block[1 << 16];
+    std::size_t read;
+    while ((read = std::fread(block, 1, sizeof(block), file)) > 0) {
+        text.append(block, read);
+    }
+    std::fclose(file);
+    return text;
+}
+
+namespace detail {
+
+inline void parse_csv_range(const char* cursor, const char* end, std::vector<int>& values) {
+    while (cursor < end) {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+            ++cursor;
+        }
+        int value;
+        auto parsed = std::from_chars(cursor, end, value);
+        if (parsed.ec == std::errc()) {
+            values.push_back(value);
+        }
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        cursor = newline == nullptr ? end : newline + 1;
+    }
+}
+
+}  // namespace detail
+
+// Below this many bytes per thread a CSV is parsed on the calling thread.
+constexpr std::size_t kParseMinChunkBytes = std::size_t{1} << 20;
+
+// Parses the leading integer of every line. Leading blanks are skipped; lines that do not start
+// with a number, such as a header, are dropped. Large inputs are cut at line breaks into one
+// chunk per thread (0 means one per hardware thread) and the chunks concatenated in order.
+inline std::vector<int> parse_csv_values(const std::string& text, unsigned threads = 1) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, text.size() / kParseMinChunkBytes));
+    std::vector<std::size_t> bounds(chunks + 1, text.size());
+    bounds[0] = 0;
+    for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+        std::size_t newline = text.find('\n', std::max(bounds[chunk - 1], text.size() / chunks * chunk));
+        bounds[chunk] = newline == std::string::npos ? text.size() : newline + 1;
+    }
+
+    std::vector<std::vector<int>> parts(chunks);
+    parallel_for(chunks, threads, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t chunk = first; chunk < last; ++chunk) {
+            TimelineSpan span("parse chunk", "parse");
+            detail::parse_csv_range(text.data() + bounds[chunk], text.data() + bounds[chunk + 1], parts[chunk]);
+        }
+    });
+    if (chunks == 1) {
+        return std::move(parts[0]);
+    }
+
+    TimelineSpan span("merge", "parse");
+    std::size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    std::vector<int> values;
+    values.reserve(total);
+    for (const auto& part : parts) {
+        values.insert(values.end(), part.begin(), part.end());
+    }
+    return values;
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_CSV_HPP
@@ -0,0 +1,127 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_ENUMERATE_HPP
+#define SPEEDY_ENUMERATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "speedy/packed.hpp"
+#include "speedy/parallel.hpp"
+#include "speedy/permutation.hpp"
+
+namespace speedy {
+
+// Walks k-permutations of n in lexicographic order from a starting rank. The start is unranked
+// once; after that each step only revisits the tail that actually changes, which is one
+// position almost every time, so a successor is amortized O(1). The permutation lives in one
+// reusable buffer.
+class PermutationCursor {
+public:
+    PermutationCursor(int n, int k, uint64_t rank)
+        : n_(n), k_(k), current_(k), free_((n + 63) / 64, 0) {
+        for (int element = 0; element < n; ++element) {
+            free_[element / 64] |= uint64_t{1} << (element % 64);
+        }
+        valid_ = unrank_permutation(n, k, rank, current_.data());
+        for (int j = 0; valid_ && j < k; ++j) {
+            take(current_[j]);
+        }
+    }
+
+    bool valid() const { return valid_; }
+    const int* data() const { return current_.data(); }
+    int size() const { return k_; }
+
+    // Moves to the next permutation; returns false, leaving the cursor invalid, past the last.
+    bool next() {
+        for (int j = k_ - 1; j >= 0; --j) {
+            release(current_[j]);
+            int larger = find_free(current_[j] + 1);
+            if (larger < n_) {
+                take(larger);
+                current_[j] = larger;
+                int from = 0;
+                for (int i = j + 1; i < k_; ++i) {
+                    current_[i] = find_free(from);
+                    take(current_[i]);
+                    from = current_[i] + 1;
+                }
+                return true;
+            }
+        }
+        valid_ = false;
+        return false;
+    }
+
+private:
+    void take(int element) { free_[element / 64] &= ~(uint64_t{1} << (element % 64)); }
+    void release(int element) { free_[element / 64] |= uint64_t{1} << (element % 64); }
+
+    // Smallest free element >= from, or n when there is none.
+    int find_free(int from) const {
+        if (from >= n_) {
+            return n_;
+        }
+        std::size_t word = from / 64;
+        uint64_t bits = free_[word] & (~uint64_t{0} << (from % 64));
+        while (bits == 0) {
+            if (++word == free_.size()) {
+                return n_;
+            }
+            bits = free_[word];
+        }
+        return static_cast<int>(word * 64 + __builtin_ctzll(bits));
+    }
+
+    int n_;
+    int k_;
+    bool valid_ = false;
+    std::vector<int> current_;
+    std::vector<uint64_t> free_;
+};
+
+// Calls fn(permutation, rank) for every rank in [begin, end), in order.
+template <typename Fn>
+void for_each_permutation(int n, int k, uint64_t begin, uint64_t end, Fn&& fn) {
+    if (begin >= end) {
+        return;
+    }
+    PermutationCursor cursor(n, k, begin);
+    for (uint64_t rank = begin; cursor.valid() && rank < end; ++rank) {
+        fn(cursor.data(), rank);
+        if (rank + 1 < end) {
+            cursor.next();
+        }
+    }
+}
+
+// Splits [begin, end) into contiguous rank ranges, one cursor per thread (0 means one per
+// hardware thread). fn is called concurrently and must be safe to call from several threads.
+template <typename Fn>
+void parallel_for_each_permutation(int n, int k, uint64_t begin, uint64_t end, unsigned threads, Fn&& fn) {
+    if (begin >= end) {
+        return;
+    }
+    parallel_for(static_cast<std::size_t>(end - begin), threads, 1 << 12, [&](std::size_t first, std::size_t last) {
+        for_each_permutation(n, k, begin + first, begin + last, fn);
+    });
+}
+
+// Packs the permutations of ranks [begin, end) into out, row i holding rank begin + i.
+inline void enumerate_packed(int n, int k, uint64_t begin, uint64_t end, PermutationArena& out, unsigned threads = 0) {
+    out.resize(begin < end ? static_cast<std::size_t>(end - begin) : 0);
+    parallel_for_each_permutation(n, k, begin, end, threads,
+                                  [&](const int* permutation, uint64_t rank) { out.set(rank - begin, permutation); });
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_ENUMERATE_HPP
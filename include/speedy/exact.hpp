@@ -0,0 +1,241 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_EXACT_HPP
+#define SPEEDY_EXACT_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace speedy {
+
+// Unsigned integer of Limbs 64-bit words, least significant first. Only the operations the
+// exact encode/decode needs: shifts, add, subtract, compare and decimal conversion.
+template <int Limbs>
+class FixedUint {
+public:
+    static constexpr int kBits = Limbs * 64;
+
+    constexpr FixedUint() : limbs_{} {}
+    constexpr FixedUint(uint64_t value) : limbs_{} { limbs_[0] = value; }
+
+    FixedUint operator<<(int shift) const {
+        FixedUint result;
+        int words = shift / 64;
+        int bits = shift % 64;
+        for (int i = Limbs - 1; i >= words; --i) {
+            uint64_t word = limbs_[i - words] << bits;
+            if (bits != 0 && i - words - 1 >= 0) {
+                word |= limbs_[i - words - 1] >> (64 - bits);
+            }
+            result.limbs_[i] = word;
+        }
+        return result;
+    }
+
+    FixedUint operator>>(int shift) const {
+        FixedUint result;
+        int words = shift / 64;
+        int bits = shift % 64;
+        for (int i = 0; i + words < Limbs; ++i) {
+            uint64_t word = limbs_[i + words] >> bits;
+            if (bits != 0 && i + words + 1 < Limbs) {
+                word |= limbs_[i + words + 1] << (64 - bits);
+            }
+            result.limbs_[i] = word;
+        }
+        return result;
+    }
+
+    FixedUint operator+(const FixedUint& other) const {
+        FixedUint result;
+        uint64_t carry = 0;
+        for (int i = 0; i < Limbs; ++i) {
+            uint64_t sum = limbs_[i] + carry;
+            carry = sum < carry;
+            result.limbs_[i] = sum + other.limbs_[i];
+            carry += result.limbs_[i] < sum;
+        }
+        return result;
+    }
+
+    FixedUint operator-(const FixedUint& other) const {
+        FixedUint result;
+        uint64_t borrow = 0;
+        for (int i = 0; i < Limbs; ++i) {
+            uint64_t diff = limbs_[i] - other.limbs_[i];
+            uint64_t next_borrow = limbs_[i] < other.limbs_[i];
+            result.limbs_[i] = diff - borrow;
+            next_borrow |= diff < borrow;
+            borrow = next_borrow;
+        }
+        return result;
+    }
+
+    bool operator==(const FixedUint& other) const { return limbs_ == other.limbs_; }
+    bool operator!=(const FixedUint& other) const { return limbs_ != other.limbs_; }
+
+    bool operator<(const FixedUint& other) const {
+        for (int i = Limbs - 1; i >= 0; --i) {
+            if (limbs_[i] != other.limbs_[i]) {
+                return limbs_[i] < other.limbs_[i];
+            }
+        }
+        return false;
+    }
+
+    int bit_width() const {
+        for (int i = Limbs - 1; i >= 0; --i) {
+            if (limbs_[i] != 0) {
+                return i * 64 + 64 - __builtin_clzll(limbs_[i]);
+            }
+        }
+        return 0;
+    }
+
+    // Divides in place by a single word and returns the remainder.
+    uint64_t divmod(uint64_t divisor) {
+        unsigned __int128 remainder = 0;
+        for (int i = Limbs - 1; i >= 0; --i) {
+            unsigned __int128 current = (remainder << 64) | limbs_[i];
+            limbs_[i] = static_cast<uint64_t>(current / divisor);
+            remainder = current % divisor;
+        }
+        return static_cast<uint64_t>(remainder);
+    }
+
+    // Multiplies in place by a single word and adds addend; returns the carry out.
+    uint64_t muladd(uint64_t factor, uint64_t addend) {
+        unsigned __int128 carry = addend;
+        for (int i = 0; i < Limbs; ++i) {
+            unsigned __int128 current = static_cast<unsigned __int128>(limbs_[i]) * factor + carry;
+            limbs_[i] = static_cast<uint64_t>(current);
+            carry = current >> 64;
+        }
+        return static_cast<uint64_t>(carry);
+    }
+
+    uint64_t limb(int index) const { return limbs_[index]; }
+
+    bool is_zero() const {
+        return std::all_of(limbs_.begin(), limbs_.end(), [](uint64_t limb) { return limb == 0; });
+    }
+
+private:
+    std::array<uint64_t, Limbs> limbs_;
+};
+
+// The widest tier: 1024 bits covers value widths plus depths far beyond any l we run.
+using ExactWide = FixedUint<16>;
+
+enum class ExactTier { kU64, kU128, kWide };
+
+// Narrowest word that holds encode(Y, D) = (Y << D) + 2^(D-1) for a value_bits-wide Y.
+inline ExactTier exact_tier(int value_bits, int layer_depth) {
+    int bits = value_bits + layer_depth;
+    if (bits <= 64) {
+        return ExactTier::kU64;
+    }
+    if (bits <= 128) {
+        return ExactTier::kU128;
+    }
+    if (bits <= ExactWide::kBits) {
+        return ExactTier::kWide;
+    }
+    throw std::length_error("encoded values need " + std::to_string(bits) + " bits, more than the widest exact tier");
+}
+
+// Calls fn with a zero of the narrowest word type for the given widths.
+template <typename Fn>
+decltype(auto) with_exact_tier(int value_bits, int layer_depth, Fn&& fn) {
+    switch (exact_tier(value_bits, layer_depth)) {
+    case ExactTier::kU64:
+        return fn(uint64_t{0});
+    case ExactTier::kU128:
+        return fn(static_cast<unsigned __int128>(0));
+    default:
+        return fn(ExactWide{});
+    }
+}
+
+// The arbitrary-precision forms from db/database.py, as shifts: Y * 2^D + 2^(D-1) and
+// (X - 2^(D-1)) // 2^D. Layer 0 carries no offset. decode expects X to be a valid encoding,
+// i.e. X >= 2^(D-1).
+template <typename Word>
+Word encode_exact(const Word& value, int layer_depth) {
+    if (layer_depth == 0) {
+        return value;
+    }
+    return (value << layer_depth) + (Word(1) << (layer_depth - 1));
+}
+
+template <typename Word>
+Word decode_exact(const Word& value, int layer_depth) {
+    if (layer_depth == 0) {
+        return value;
+    }
+    return (value - (Word(1) << (layer_depth - 1))) >> layer_depth;
+}
+
+// The forward counterpart of the reverse layer walk: depth applications of v -> 2v + 1 + d for
+// d = 1..depth, which composes to (Y << D) + 3 * 2^D - D - 3. walk_layers(encode_layers_exact(Y, D), D)
+// gives back Y. The result needs value_bits + depth + 2 bits.
+template <typename Word>
+Word encode_layers_exact(const Word& value, int layer_depth) {
+    return (value << layer_depth) + (Word(3) << layer_depth) - Word(static_cast<uint64_t>(layer_depth) + 3);
+}
+
+template <typename Word>
+std::string exact_to_string(Word value) {
+    if (value == Word(0)) {
+        return "0";
+    }
+    std::string digits;
+    while (value != Word(0)) {
+        if constexpr (std::is_integral_v<Word> || std::is_same_v<Word, unsigned __int128>) {
+            digits.push_back(static_cast<char>('0' + static_cast<int>(value % 10)));
+            value /= 10;
+        } else {
+            digits.push_back(static_cast<char>('0' + value.divmod(10)));
+        }
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+// Parses a decimal string. Throws std::invalid_argument on anything but digits and
+// std::out_of_range when the number does not fit Word.
+template <typename Word>
+Word exact_from_string(const std::string& text) {
+    Word value(0);
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            throw std::invalid_argument("not an unsigned integer: " + text);
+        }
+        unsigned digit = static_cast<unsigned>(c - '0');
+        bool overflow;
+        if constexpr (std::is_integral_v<Word> || std::is_same_v<Word, unsigned __int128>) {
+            overflow = value > (~Word(0) - digit) / 10;
+            value = value * 10 + digit;
+        } else {
+            overflow = value.muladd(10, digit) != 0;
+        }
+        if (overflow) {
+            throw std::out_of_range("too large for " + std::to_string(sizeof(Word) * 8) + " bits: " + text);
+        }
+    }
+    return value;
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_EXACT_HPP
@@ -0,0 +1,267 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_GENERATE_HPP
+#define SPEEDY_GENERATE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "speedy/parallel.hpp"
+#include "speedy/sample.hpp"
+
+namespace speedy {
+
+namespace detail {
+
+// splitmix64's finalizer; the Feistel round function and key schedule.
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1) from the top 53 bits of a draw.
+template <typename Rng>
+double uniform_unit(Rng& rng) {
+    return static_cast<double>(rng() >> 11) * 0x1.0p-53;
+}
+
+}  // namespace detail
+
+// A keyed bijection on [0, domain): a Feistel network over the smallest bit width that covers
+// the domain, but at least 2 bits so both halves are non-empty, cycle-walked until the output
+// lands back inside it. Odd widths split unevenly, with the halves swapping sizes each round.
+// For domains above 2 the width is therefore under twice the domain and a query averages fewer
+// than two passes; domains 1 and 2 walk a 4-value width. No state is needed beyond the round
+// keys and any index maps independently, which lets a shuffled 1..N stream out in parallel in
+// constant memory.
+class KeyedPermutation {
+public:
+    KeyedPermutation(uint64_t domain, uint64_t seed) : domain_(domain) {
+        if (domain == 0) {
+            throw std::length_error("a keyed permutation needs a non-empty domain");
+        }
+        while (bits_ < 64 && (uint64_t{1} << bits_) < domain) {
+            ++bits_;
+        }
+        uint64_t key = seed;
+        for (auto& round_key : keys_) {
+            key += 0x9e3779b97f4a7c15ull;
+            round_key = detail::mix64(key);
+        }
+    }
+
+    uint64_t domain() const { return domain_; }
+
+    // Image of index, which must be below domain().
+    uint64_t operator()(uint64_t index) const {
+        uint64_t x = index;
+        do {
+            x = encrypt(x);
+        } while (x >= domain_);
+        return x;
+    }
+
+private:
+    static constexpr int kRounds = 4;
+
+    // Each round maps (left, right) to (right, left ^ F(right)), which is invertible whatever
+    // the widths of the two halves.
+    uint64_t encrypt(uint64_t x) const {
+        int right_bits = bits_ / 2;
+        for (uint64_t key : keys_) {
+            int left_bits = bits_ - right_bits;
+            uint64_t left = x >> right_bits;
+            uint64_t right = x & ((uint64_t{1} << right_bits) - 1);
+            x = (right << left_bits) | ((left ^ detail::mix64(right ^ key)) & ((uint64_t{1} << left_bits) - 1));
+            right_bits = left_bits;
+        }
+        return x;
+    }
+
+    uint64_t domain_;
+    int bits_ = 2;
+    uint64_t keys_[kRounds] = {};
+};
+
+// Zipf-distributed ranks in [1, count] with P(r) proportional to r^-exponent, by Hörmann and
+// Derflinger's rejection-inversion: O(1) per draw with no table, so count can be any 64-bit
+// size.
+class ZipfSampler {
+public:
+    ZipfSampler(uint64_t count, double exponent) : count_(count), exponent_(exponent) {
+        if (count == 0 || !(exponent > 0)) {
+            throw std::length_error("Zipf needs a non-empty range and a positive exponent");
+        }
+        h_integral_x1_ = h_integral(1.5) - 1.0;
+        h_integral_n_ = h_integral(static_cast<double>(count) + 0.5);
+        s_ = 2.0 - h_integral_inverse(h_integral(2.5) - h(2.0));
+    }
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) const {
+        while (true) {
+            double u = h_integral_n_ + detail::uniform_unit(rng) * (h_integral_x1_ - h_integral_n_);
+            double x = h_integral_inverse(u);
+            double rounded = std::min(std::max(std::floor(x + 0.5), 1.0), static_cast<double>(count_));
+            uint64_t rank = std::min(static_cast<uint64_t>(rounded), count_);
+            if (rounded - x <= s_ || u >= h_integral(rounded + 0.5) - h(rounded)) {
+                return rank;
+            }
+        }
+    }
+
+private:
+    // log1p(x) / x and expm1(x) / x, with their series near zero.
+    static double log1p_ratio(double x) {
+        return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    static double expm1_ratio(double x) {
+        return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+
+    double h(double x) const { return std::exp(-exponent_ * std::log(x)); }
+
+    double h_integral(double x) const {
+        double log_x = std::log(x);
+        return expm1_ratio((1.0 - exponent_) * log_x) * log_x;
+    }
+
+    double h_integral_inverse(double x) const {
+        double t = std::max(x * (1.0 - exponent_), -1.0);
+        return std::exp(log1p_ratio(t) * x);
+    }
+
+    uint64_t count_;
+    double exponent_;
+    double h_integral_x1_ = 0;
+    double h_integral_n_ = 0;
+    double s_ = 0;
+};
+
+enum class Distribution { shuffled, sorted, reversed, zipf, duplicates };
+
+inline Distribution parse_distribution(const std::string& name) {
+    if (name == "shuffled") {
+        return Distribution::shuffled;
+    }
+    if (name == "sorted") {
+        return Distribution::sorted;
+    }
+    if (name == "reversed") {
+        return Distribution::reversed;
+    }
+    if (name == "zipf") {
+        return Distribution::zipf;
+    }
+    if (name == "duplicates") {
+        return Distribution::duplicates;
+    }
+    throw std::runtime_error("unknown distribution " + name +
+                             "; expected shuffled, sorted, reversed, zipf or duplicates");
+}
+
+// A dataset of count values drawn from 1..domain:
+// - shuffled: distinct values in keyed random order; every value once when count == domain
+// - sorted, reversed: count evenly spaced distinct values in order
+// - zipf: values whose popularity falls off as rank^-zipf_exponent, ranks scattered by the key
+// - duplicates: uniform picks from a scattered pool of distinct values
+struct DatasetSpec {
+    uint64_t domain = 0;
+    uint64_t count = 0;
+    Distribution distribution = Distribution::shuffled;
+    uint64_t seed = 0;
+    double zipf_exponent = 1.1;
+    uint64_t distinct = 0;
+};
+
+// Writes values [first, first + count) of the dataset to out. Every value depends only on the
+// spec and its position, so chunks can be produced in any order and on any thread count;
+// first must be a multiple of kSampleBlock for the random distributions.
+class DatasetGenerator {
+public:
+    explicit DatasetGenerator(const DatasetSpec& spec)
+        : spec_(spec), permutation_(spec.domain, spec.seed) {
+        // Only the zipf distribution draws ranks, so only it needs a valid exponent.
+        if (spec.distribution == Distribution::zipf) {
+            zipf_.emplace(spec.domain, spec.zipf_exponent);
+        }
+        bool distinct_values = spec.distribution == Distribution::shuffled ||
+                               spec.distribution == Distribution::sorted ||
+                               spec.distribution == Distribution::reversed;
+        if (distinct_values && spec.count > spec.domain) {
+            throw std::length_error(std::to_string(spec.count) + " distinct values do not fit in 1.." +
+                                    std::to_string(spec.domain));
+        }
+        if (spec_.distinct == 0) {
+            spec_.distinct = std::max<uint64_t>(1, spec.count / 8);
+        }
+        spec_.distinct = std::min(spec_.distinct, spec.domain);
+    }
+
+    const DatasetSpec& spec() const { return spec_; }
+
+    void generate(uint64_t first, std::size_t count, uint64_t* out, unsigned threads = 0) const {
+        if (first % kSampleBlock != 0) {
+            throw std::runtime_error("dataset chunks must start on a sample block boundary");
+        }
+        std::size_t blocks = (count + kSampleBlock - 1) / kSampleBlock;
+        parallel_for(blocks, threads, 4, [&](std::size_t begin_block, std::size_t end_block) {
+            for (std::size_t block = begin_block; block < end_block; ++block) {
+                std::size_t begin = block * kSampleBlock;
+                std::size_t end = std::min(count, begin + kSampleBlock);
+                generate_block(first + begin, end - begin, out + begin);
+            }
+        });
+    }
+
+private:
+    void generate_block(uint64_t first, std::size_t count, uint64_t* out) const {
+        Xoshiro256 rng(spec_.seed, first / kSampleBlock);
+        for (std::size_t i = 0; i < count; ++i) {
+            uint64_t index = first + i;
+            switch (spec_.distribution) {
+                case Distribution::shuffled:
+                    out[i] = permutation_(index) + 1;
+                    break;
+                case Distribution::sorted:
+                    out[i] = spaced(index);
+                    break;
+                case Distribution::reversed:
+                    out[i] = spaced(spec_.count - 1 - index);
+                    break;
+                case Distribution::zipf:
+                    out[i] = permutation_((*zipf_)(rng) - 1) + 1;
+                    break;
+                case Distribution::duplicates:
+                    out[i] = permutation_(uniform_below(rng, spec_.distinct)) + 1;
+                    break;
+            }
+        }
+    }
+
+    // The index-th of count evenly spaced values in 1..domain.
+    uint64_t spaced(uint64_t index) const {
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(index) * spec_.domain / spec_.count) + 1;
+    }
+
+    DatasetSpec spec_;
+    KeyedPermutation permutation_;
+    std::optional<ZipfSampler> zipf_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_GENERATE_HPP
@@ -0,0 +1,133 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_LAYERS_HPP
+#define SPEEDY_LAYERS_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace speedy {
+
+// Number of layers for a (n, k) search space: ceil(k * log2(n)), i.e. the bit length of
+// n^k - 1. Computed with exact multi-limb arithmetic so it can size templates at compile
+// time; returns -1 when n^k does not fit in 2048 bits.
+constexpr int layer_count(int n, int k) {
+    if (n <= 1 || k <= 0) {
+        return 0;
+    }
+
+    constexpr int kLimbs = 64;
+    uint32_t limbs[kLimbs] = {1};
+    int used = 1;
+    for (int step = 0; step < k; ++step) {
+        uint64_t carry = 0;
+        for (int i = 0; i < used; ++i) {
+            uint64_t product = static_cast<uint64_t>(limbs[i]) * static_cast<uint32_t>(n) + carry;
+            limbs[i] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            if (used == kLimbs) {
+                return -1;
+            }
+            limbs[used++] = static_cast<uint32_t>(carry);
+        }
+    }
+
+    int borrow = 0;
+    while (limbs[borrow] == 0) {
+        limbs[borrow++] = 0xffffffffu;
+    }
+    limbs[borrow] -= 1;
+    while (used > 1 && limbs[used - 1] == 0) {
+        --used;
+    }
+
+    int bits = (used - 1) * 32;
+    for (uint32_t top = limbs[used - 1]; top != 0; top >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+// One layer of the reverse walk: decode(value, 1) - layer_depth / 2.0, truncated to int.
+// For integer inputs this is exactly (value - 1 - layer_depth) / 2 rounded toward zero.
+inline int decode_layer(int value, int layer_depth) {
+    return static_cast<int>(value / 2.0 - 0.5 - layer_depth / 2.0);
+}
+
+// Reference layered walk from layer_depth down to layer 0.
+inline int walk_layers(int value, int layer_depth) {
+    for (int depth = layer_depth; depth > 0; --depth) {
+        value = decode_layer(value, depth);
+    }
+    return value;
+}
+
+// All layers of the walk composed into a single transform.
+//
+// While (value - 1 - depth) stays non-negative every layer truncates like a floor, so the
+// first m layers collapse to floor((value - C[m]) / 2^m) with
+// C[m] = (l + 3 - m) * 2^m - l - 3. Once it goes negative it stays negative and the
+// remaining r layers (depths r..1) truncate like a ceiling, which collapses to
+// ceil((x + r + 3) / 2^r) - 3. A query is one threshold search plus two shifts.
+class LayerPlan {
+public:
+    explicit LayerPlan(int layer_depth) : layer_depth_(layer_depth) {
+        thresholds_[0] = 0;
+        for (int m = 1; m <= layer_depth && m < kMaxFloorLayers; ++m) {
+            int64_t step = 0;
+            int64_t next = 0;
+            if (__builtin_mul_overflow(static_cast<int64_t>(layer_depth - m + 2), int64_t{1} << (m - 1), &step) ||
+                __builtin_add_overflow(thresholds_[m - 1], step, &next)) {
+                break;
+            }
+            thresholds_[m] = next;
+            floor_layers_ = m;
+        }
+    }
+
+    int layer_depth() const { return layer_depth_; }
+
+    int64_t apply(int64_t value) const {
+        // Number of leading layers that behave like a floor: largest m with C[m] <= value.
+        int lo = 0;
+        int hi = floor_layers_;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (thresholds_[mid] <= value) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        int64_t x = lo == 0 ? value : (value - thresholds_[lo]) >> lo;
+        int64_t remaining = layer_depth_ - lo;
+        return ceil_shift(x + remaining + 3, remaining) - 3;
+    }
+
+private:
+    static constexpr int kMaxFloorLayers = 63;
+
+    static int64_t ceil_shift(int64_t value, int64_t shift) {
+        if (shift >= 63) {
+            return value > 0 ? 1 : 0;
+        }
+        return -((-value) >> shift);
+    }
+
+    int layer_depth_;
+    int floor_layers_ = 0;
+    std::array<int64_t, kMaxFloorLayers> thresholds_{};
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_LAYERS_HPP
@@ -0,0 +1,70 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_LIBRARY_HPP
+#define SPEEDY_LIBRARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The compiled interface of libspeedy. Programs that only need loading, reduction, the reverse
+// path and (un)ranking link against the library and include this header alone; the kernels,
+// CPU dispatch and tables behind it are built once into the library.
+
+namespace speedy {
+namespace lib {
+
+// Loads the values of a CSV file, or of a 64-bit layer file written by speedy_encode or
+// speedy_gen, which is recognized by its magic. CSV parsing is split across threads
+// (0 means one per hardware thread). Throws std::runtime_error on unreadable input.
+std::vector<int> load_values(const std::string& path, unsigned threads = 0);
+
+// Extremum of a non-empty set of values, reduced across threads.
+int min_value(const std::vector<int>& values, unsigned threads = 0);
+int max_value(const std::vector<int>& values, unsigned threads = 0);
+
+// The reverse path for one (n, k): walks encoded values down every layer and unranks the
+// layer-0 index. Uses a specialized chain when the library was built with one for (n, k).
+class Solver {
+public:
+    Solver(int n, int k);
+    ~Solver();
+    Solver(Solver&&) noexcept;
+    Solver& operator=(Solver&&) noexcept;
+
+    int n() const;
+    int k() const;
+    int layers() const;
+    // Ints written per permutation: k, or 0 when k > n.
+    int width() const;
+
+    // Layer-0 index of value.
+    int64_t reverse_index(int value) const;
+    // Writes the k-permutation of value to permutation[0, width()).
+    void reverse(int value, int* permutation) const;
+    // Layer-0 index of every value, in AVX2 lanes where available and across threads.
+    void reverse_indices(const int* values, std::size_t count, int* indices, unsigned threads = 0) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// The rank-th k-permutation of {0, ..., n-1} in lexicographic order, with ranks wrapping
+// modulo P(n, k), and its inverse. Both return false when k > n; rank also when an element
+// repeats or falls outside [0, n).
+bool unrank(int n, int k, uint64_t rank, int* permutation);
+bool rank(int n, int k, const int* permutation, uint64_t& rank);
+
+}  // namespace lib
+}  // namespace speedy
+
+#endif  // SPEEDY_LIBRARY_HPP
@@ -0,0 +1,172 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_MEMORY_HPP
+#define SPEEDY_MEMORY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+namespace speedy {
+
+// Process-wide heap counters, fed by the operator new replacements that
+// SPEEDY_COUNT_ALLOCATIONS() defines. Sizes are what malloc actually handed out.
+struct AllocationCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> live{0};
+    std::atomic<uint64_t> peak{0};
+};
+
+inline AllocationCounters& allocation_counters() {
+    static AllocationCounters counters;
+    return counters;
+}
+
+struct AllocationSnapshot {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+inline AllocationSnapshot allocation_snapshot() {
+    AllocationCounters& counters = allocation_counters();
+    return {counters.allocations.load(std::memory_order_relaxed), counters.bytes.load(std::memory_order_relaxed)};
+}
+
+// Restarts the live-heap high-water mark from what is live now.
+inline void reset_peak_heap() {
+    AllocationCounters& counters = allocation_counters();
+    counters.peak.store(counters.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+inline uint64_t peak_heap_bytes() { return allocation_counters().peak.load(std::memory_order_relaxed); }
+
+namespace detail {
+
+inline std::size_t usable_size(void* pointer, std::size_t requested) {
+#ifdef __linux__
+    (void)requested;
+    return malloc_usable_size(pointer);
+#else
+    (void)pointer;
+    return requested;
+#endif
+}
+
+inline void count_allocation(void* pointer, std::size_t requested) {
+    AllocationCounters& counters = allocation_counters();
+    uint64_t size = usable_size(pointer, requested);
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t live = counters.live.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = counters.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+inline void* counted_new(std::size_t size) {
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    count_allocation(pointer, size);
+    return pointer;
+}
+
+inline void* counted_new(std::size_t size, std::align_val_t alignment) {
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    count_allocation(pointer, size);
+    return pointer;
+}
+
+inline void counted_delete(void* pointer) {
+    if (pointer != nullptr) {
+        allocation_counters().live.fetch_sub(usable_size(pointer, 0), std::memory_order_relaxed);
+        std::free(pointer);
+    }
+}
+
+}  // namespace detail
+
+// Restarts the kernel's resident-set high-water mark (VmHWM) from the current RSS. Returns
+// false where /proc/self/clear_refs is missing or not writable; peak_rss_bytes() then keeps
+// reporting the peak since the process started.
+inline bool reset_peak_rss() {
+#ifdef __linux__
+    std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && written;
+#else
+    return false;
+#endif
+}
+
+inline uint64_t peak_rss_bytes() {
+#ifdef __linux__
+    if (std::FILE* file = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            unsigned long long kilobytes = 0;
+            if (std::sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1) {
+                std::fclose(file);
+                return kilobytes * 1024;
+            }
+        }
+        std::fclose(file);
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#else
+    return 0;
+#endif
+}
+
+}  // namespace speedy
+
+// Replaces the global allocation functions with counting ones. Expand once, at namespace scope,
+// in the translation unit that holds main.
+#define SPEEDY_COUNT_ALLOCATIONS()                                                                                  \
+    void* operator new(std::size_t size) { return ::speedy::detail::counted_new(size); }                            \
+    void* operator new[](std::size_t size) { return ::speedy::detail::counted_new(size); }                          \
+    void* operator new(std::size_t size, std::align_val_t alignment) {                                              \
+        return ::speedy::detail::counted_new(size, alignment);                                                      \
+    }                                                                                                               \
+    void* operator new[](std::size_t size, std::align_val_t alignment) {                                            \
+        return ::speedy::detail::counted_new(size, alignment);                                                      \
+    }                                                                                                               \
+    void operator delete(void* pointer) noexcept { ::speedy::detail::counted_delete(pointer); }                     \
+    void operator delete[](void* pointer) noexcept { ::speedy::detail::counted_delete(pointer); }                   \
+    void operator delete(void* pointer, std::size_t) noexcept { ::speedy::detail::counted_delete(pointer); }        \
+    void operator delete[](void* pointer, std::size_t) noexcept { ::speedy::detail::counted_delete(pointer); }      \
+    void operator delete(void* pointer, std::align_val_t) noexcept { ::speedy::detail::counted_delete(pointer); }   \
+    void operator delete[](void* pointer, std::align_val_t) noexcept { ::speedy::detail::counted_delete(pointer); } \
+    void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {                                   \
+        ::speedy::detail::counted_delete(pointer);                                                                  \
+    }                                                                                                               \
+    void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {                                 \
+        ::speedy::detail::counted_delete(pointer);                                                                  \
+    }
+
+#endif  // SPEEDY_MEMORY_HPP
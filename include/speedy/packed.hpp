@@ -0,0 +1,201 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_PACKED_HPP
+#define SPEEDY_PACKED_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPEEDY_HAVE_X86_SIMD 1
+#endif
+
+namespace speedy {
+
+// Bits per element for a permutation of {0, ..., n - 1}: the bit width of n - 1, at least 1.
+constexpr int packed_bits(int n) {
+    int bits = 1;
+    while (bits < 31 && (int64_t{1} << bits) < n) {
+        ++bits;
+    }
+    return bits;
+}
+
+// 64-bit words holding k fields of packed_bits(n) bits.
+constexpr int packed_words(int n, int k) { return (k * packed_bits(n) + 63) / 64; }
+
+namespace detail {
+
+inline uint64_t field_mask(int bits) { return (uint64_t{1} << bits) - 1; }
+
+// Fields are stored least significant first and may straddle a word boundary. row must start
+// zeroed.
+inline void pack_row(const int* elements, int k, int bits, uint64_t* row) {
+    for (int j = 0; j < k; ++j) {
+        int offset = j * bits;
+        int shift = offset % 64;
+        uint64_t field = static_cast<uint64_t>(elements[j]) & field_mask(bits);
+        row[offset / 64] |= field << shift;
+        if (shift + bits > 64) {
+            row[offset / 64 + 1] |= field >> (64 - shift);
+        }
+    }
+}
+
+inline int unpack_field(const uint64_t* row, int bits, int j) {
+    int offset = j * bits;
+    int shift = offset % 64;
+    uint64_t field = row[offset / 64] >> shift;
+    if (shift + bits > 64) {
+        field |= row[offset / 64 + 1] << (64 - shift);
+    }
+    return static_cast<int>(field & field_mask(bits));
+}
+
+inline void unpack_rows_scalar(const uint64_t* words, std::size_t rows, int k, int bits, int* out) {
+    int stride = (k * bits + 63) / 64;
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (int j = 0; j < k; ++j) {
+            out[r * k + j] = unpack_field(words + r * stride, bits, j);
+        }
+    }
+}
+
+#ifdef SPEEDY_HAVE_X86_SIMD
+// Rows that fit one word: broadcast it, shift four lanes by four field offsets at once, mask,
+// and narrow the 64-bit lanes to four ints.
+__attribute__((target("avx2")))
+inline void unpack_rows_avx2(const uint64_t* words, std::size_t rows, int k, int bits, int* out) {
+    __m256i shifts[16];
+    int groups = k / 4;
+    for (int g = 0; g < groups; ++g) {
+        int base = g * 4 * bits;
+        shifts[g] = _mm256_setr_epi64x(base, base + bits, base + 2 * bits, base + 3 * bits);
+    }
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(field_mask(bits)));
+    const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    for (std::size_t r = 0; r < rows; ++r) {
+        __m256i word = _mm256_set1_epi64x(static_cast<long long>(words[r]));
+        int* row = out + r * k;
+        for (int g = 0; g < groups; ++g) {
+            __m256i fields = _mm256_and_si256(_mm256_srlv_epi64(word, shifts[g]), mask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + g * 4),
+                             _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(fields, narrow)));
+        }
+        for (int j = groups * 4; j < k; ++j) {
+            row[j] = static_cast<int>((words[r] >> (j * bits)) & field_mask(bits));
+        }
+    }
+}
+#endif
+
+inline void unpack_rows(const uint64_t* words, std::size_t rows, int k, int bits, int* out) {
+#ifdef SPEEDY_HAVE_X86_SIMD
+    if (k * bits <= 64 && __builtin_cpu_supports("avx2")) {
+        unpack_rows_avx2(words, rows, k, bits, out);
+        return;
+    }
+#endif
+    unpack_rows_scalar(words, rows, k, bits, out);
+}
+
+}  // namespace detail
+
+// One k-permutation of n packed into a fixed inline buffer of Words 64-bit words, so it can
+// live in a container or cache slot without a heap allocation. Throws std::length_error when
+// k fields of packed_bits(n) bits do not fit.
+template <int Words = 2>
+class PackedPermutation {
+public:
+    static constexpr bool fits(int n, int k) { return k >= 0 && packed_words(n, k) <= Words; }
+
+    PackedPermutation() = default;
+
+    PackedPermutation(int n, int k, const int* elements) : bits_(packed_bits(n)), size_(k) {
+        if (!fits(n, k)) {
+            throw std::length_error("permutation does not fit the packed buffer");
+        }
+        detail::pack_row(elements, k, bits_, words_.data());
+    }
+
+    int size() const { return size_; }
+    int operator[](int j) const { return detail::unpack_field(words_.data(), bits_, j); }
+    void unpack(int* out) const { detail::unpack_rows_scalar(words_.data(), 1, size_, bits_, out); }
+
+    bool operator==(const PackedPermutation& other) const {
+        return size_ == other.size_ && bits_ == other.bits_ && words_ == other.words_;
+    }
+    bool operator!=(const PackedPermutation& other) const { return !(*this == other); }
+
+private:
+    std::array<uint64_t, Words> words_{};
+    uint8_t bits_ = 1;
+    uint8_t size_ = 0;
+};
+
+// Contiguous storage for many k-permutations of n, each a word-aligned row of
+// packed_words(n, k) words. Rows are independent, so threads may fill disjoint rows after a
+// resize.
+class PermutationArena {
+public:
+    PermutationArena(int n, int k)
+        : n_(n), k_(k), bits_(packed_bits(n)), stride_(packed_words(n, k)) {}
+
+    int n() const { return n_; }
+    int k() const { return k_; }
+    int bits() const { return bits_; }
+    int row_words() const { return stride_; }
+    std::size_t size() const { return rows_; }
+    std::size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+    const uint64_t* data() const { return words_.data(); }
+
+    void reserve(std::size_t rows) { words_.reserve(rows * stride_); }
+    void clear() { resize(0); }
+    void resize(std::size_t rows) {
+        words_.resize(rows * stride_);
+        rows_ = rows;
+    }
+
+    void push_back(const int* elements) {
+        resize(size() + 1);
+        set(size() - 1, elements);
+    }
+
+    void set(std::size_t row, const int* elements) {
+        uint64_t* words = words_.data() + row * stride_;
+        std::fill(words, words + stride_, uint64_t{0});
+        detail::pack_row(elements, k_, bits_, words);
+    }
+
+    int get(std::size_t row, int j) const { return detail::unpack_field(words_.data() + row * stride_, bits_, j); }
+
+    void unpack(std::size_t row, int* out) const { unpack(row, 1, out); }
+
+    // Unpacks count rows starting at first into count * k ints.
+    void unpack(std::size_t first, std::size_t count, int* out) const {
+        detail::unpack_rows(words_.data() + first * stride_, count, k_, bits_, out);
+    }
+
+private:
+    int n_;
+    int k_;
+    int bits_;
+    int stride_;
+    std::size_t rows_ = 0;
+    std::vector<uint64_t> words_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_PACKED_HPP
@@ -0,0 +1,52 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_PARALLEL_HPP
+#define SPEEDY_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace speedy {
+
+// Number of ranges, and so threads, parallel_for uses for these arguments.
+inline std::size_t parallel_chunks(std::size_t count, unsigned threads, std::size_t min_chunk) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    min_chunk = std::max<std::size_t>(1, min_chunk);
+    return std::max<std::size_t>(1, std::min<std::size_t>(threads, (count + min_chunk - 1) / min_chunk));
+}
+
+// Splits [0, count) into at most threads contiguous ranges of at least min_chunk items and
+// runs fn(begin, end) on each, the first on the calling thread. threads == 0 means one per
+// hardware thread.
+template <typename Fn>
+void parallel_for(std::size_t count, unsigned threads, std::size_t min_chunk, Fn&& fn) {
+    std::size_t chunks = parallel_chunks(count, threads, min_chunk);
+    if (chunks <= 1) {
+        fn(std::size_t{0}, count);
+        return;
+    }
+
+    std::size_t chunk_size = (count + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    for (std::size_t begin = chunk_size; begin < count; begin += chunk_size) {
+        workers.emplace_back(fn, begin, std::min(count, begin + chunk_size));
+    }
+    fn(std::size_t{0}, std::min(count, chunk_size));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_PARALLEL_HPP
@@ -0,0 +1,138 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_PERF_HPP
+#define SPEEDY_PERF_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace speedy {
+
+// Hardware counters for one phase, by name. Counts are scaled up when the kernel had to
+// multiplex the group.
+using CounterValues = std::vector<std::pair<std::string, uint64_t>>;
+
+// A perf_event_open group around the calling process: cycles and instructions lead, then cache,
+// branch and data-TLB misses. Counters the PMU or the kernel refuses are skipped, and when the
+// leader itself cannot be opened (no PMU, perf_event_paranoid, seccomp) the group is simply
+// unavailable. User space only, and inherited by threads started while it runs.
+//
+// An inherited thread's counts only reach the group when the thread's perf context is torn
+// down in the kernel's do_exit, after exit_mm has already released pthread_join. A phase that
+// reads the group straight after joining its workers can therefore miss the tail of their
+// counts, so worker-heavy phases may be undercounted.
+class PerfCounters {
+public:
+    PerfCounters() {
+#ifdef __linux__
+        struct Spec {
+            const char* name;
+            uint32_t type;
+            uint64_t config;
+        };
+        const Spec specs[] = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"dtlb_load_misses", PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        };
+        for (const Spec& spec : specs) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = spec.type;
+            attr.config = spec.config;
+            attr.disabled = counters_.empty() ? 1 : 0;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int leader = counters_.empty() ? -1 : counters_.front().second;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (counters_.empty()) {
+                    error_ = std::string("perf_event_open: ") + std::strerror(errno);
+                    return;
+                }
+                continue;
+            }
+            counters_.emplace_back(spec.name, fd);
+        }
+#else
+        error_ = "perf_event_open needs Linux";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (auto& counter : counters_) {
+            close(counter.second);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return !counters_.empty(); }
+    const std::string& error() const { return error_; }
+
+    void start() {
+#ifdef __linux__
+        if (available()) {
+            ioctl(counters_.front().second, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(counters_.front().second, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    // Each counter is read on its own: the kernel does not allow group reads of inherited events.
+    CounterValues stop() {
+        CounterValues values;
+#ifdef __linux__
+        if (!available()) {
+            return values;
+        }
+        ioctl(counters_.front().second, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (auto& counter : counters_) {
+            uint64_t data[3] = {0, 0, 0};
+            if (read(counter.second, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+                continue;
+            }
+            uint64_t value = data[0];
+            if (data[2] < data[1]) {
+                value = static_cast<uint64_t>(static_cast<double>(value) * data[1] / data[2]);
+            }
+            values.emplace_back(counter.first, value);
+        }
+#endif
+        return values;
+    }
+
+private:
+    std::vector<std::pair<std::string, int>> counters_;
+    std::string error_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_PERF_HPP
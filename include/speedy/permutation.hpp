@@ -0,0 +1,334 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_PERMUTATION_HPP
+#define SPEEDY_PERMUTATION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPEEDY_HAVE_BMI2_DISPATCH 1
+#endif
+
+#include "speedy/parallel.hpp"
+#include "speedy/tables.hpp"
+
+namespace speedy {
+
+// P(n, k) = n! / (n - k)!, the number of k-permutations of n elements, looked up in
+// kFallingFactorials when it is tabulated. Returns false when it overflows Rank.
+template <typename Rank>
+bool permutation_count(int n, int k, Rank& count) {
+    if (sizeof(Rank) >= sizeof(uint64_t) && n >= 0 && n <= kTableMaxN && k >= 0 && k <= kMaxExactK[n]) {
+        count = static_cast<Rank>(kFallingFactorials[n][k]);
+        return true;
+    }
+    count = (k < 0 || k > n) ? 0 : 1;
+    for (int j = 0; j < k && j < n; ++j) {
+        if (__builtin_mul_overflow(count, static_cast<Rank>(n - j), &count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace detail {
+
+// Falling-factorial digits of rank, most significant first: digit j has radix n - j, so
+// rank = sum(digit[j] * P(n - j - 1, k - j - 1)). Whatever is left above the top digit is
+// dropped, which wraps ranks modulo P(n, k).
+template <typename Rank>
+inline void rank_digits(int n, int k, Rank rank, int* digits) {
+    for (int j = k - 1; j >= 0; --j) {
+        Rank radix = static_cast<Rank>(n - j);
+        digits[j] = static_cast<int>(rank % radix);
+        rank /= radix;
+    }
+}
+
+// 64-bit ranks divide by the tabulated reciprocal of each radix instead of a hardware divide.
+inline void rank_digits(int n, int k, uint64_t rank, int* digits) {
+    if (n > kTableMaxN) {
+        rank_digits<uint64_t>(n, k, rank, digits);
+        return;
+    }
+    for (int j = k - 1; j >= 0; --j) {
+        const Reciprocal& radix = kReciprocals[n - j];
+        uint64_t quotient = radix.divide(rank);
+        digits[j] = static_cast<int>(rank - quotient * radix.divisor);
+        rank = quotient;
+    }
+}
+
+}  // namespace detail
+
+// Turns falling-factorial digits into elements: each digit d becomes the d-th smallest element
+// not yet taken, found by descending a Fenwick tree of "still free" counts in O(log n). The
+// tree is put back after every call, so one selector serves any number of permutations.
+class PermutationSelector {
+public:
+    explicit PermutationSelector(int n) : n_(n), tree_(n + 1) {
+        for (int index = 1; index <= n; ++index) {
+            tree_[index] = index & -index;
+        }
+        top_ = 1;
+        while (top_ * 2 <= n) {
+            top_ *= 2;
+        }
+    }
+
+    int n() const { return n_; }
+
+    void select(int k, int* digits) {
+        for (int j = 0; j < k; ++j) {
+            digits[j] = take(digits[j]);
+        }
+        for (int j = 0; j < k; ++j) {
+            add(digits[j] + 1, 1);
+        }
+    }
+
+    // The inverse of select: calls fn(j, digit) with the number of still-free elements below
+    // elements[j]. Returns false on the first element that repeats or falls outside [0, n).
+    template <typename Fn>
+    bool for_each_digit(int k, const int* elements, Fn&& fn) {
+        int taken = 0;
+        bool valid = true;
+        for (; taken < k; ++taken) {
+            int element = elements[taken];
+            if (element < 0 || element >= n_) {
+                valid = false;
+                break;
+            }
+            int below = prefix(element);
+            if (prefix(element + 1) == below) {
+                valid = false;
+                break;
+            }
+            fn(taken, below);
+            add(element + 1, -1);
+        }
+        for (int j = 0; j < taken; ++j) {
+            add(elements[j] + 1, 1);
+        }
+        return valid;
+    }
+
+private:
+    int prefix(int index) const {
+        int sum = 0;
+        for (; index > 0; index -= index & -index) {
+            sum += tree_[index];
+        }
+        return sum;
+    }
+
+    int take(int digit) {
+        int position = 0;
+        int remaining = digit + 1;
+        for (int step = top_; step != 0; step >>= 1) {
+            if (position + step <= n_ && tree_[position + step] < remaining) {
+                position += step;
+                remaining -= tree_[position];
+            }
+        }
+        add(position + 1, -1);
+        return position;
+    }
+
+    void add(int index, int delta) {
+        for (; index <= n_; index += index & -index) {
+            tree_[index] += delta;
+        }
+    }
+
+    int n_;
+    int top_;
+    std::vector<int> tree_;
+};
+
+inline PermutationSelector& thread_selector(int n) {
+    thread_local std::unique_ptr<PermutationSelector> selector;
+    if (!selector || selector->n() != n) {
+        selector = std::make_unique<PermutationSelector>(n);
+    }
+    return *selector;
+}
+
+namespace detail {
+
+// Position of the rank-th set bit of mask. Halves the window six times, keeping whichever half
+// holds the bit by popcount; every step is a select, not a branch.
+inline int select_bit(uint64_t mask, int rank) {
+    int base = 0;
+    for (int width = 32; width >= 1; width /= 2) {
+        uint64_t low = mask & ((uint64_t{1} << width) - 1);
+        int count = __builtin_popcountll(low);
+        bool upper = rank >= count;
+        rank -= upper ? count : 0;
+        mask = upper ? mask >> width : low;
+        base += upper ? width : 0;
+    }
+    return base;
+}
+
+inline uint64_t full_mask(int n) { return n == 64 ? ~uint64_t{0} : (uint64_t{1} << n) - 1; }
+
+// For n <= 64 the unused elements fit one availability mask, so each digit is a single select.
+inline void select_in_mask_portable(int n, int k, int* digits) {
+    uint64_t available = full_mask(n);
+    for (int j = 0; j < k; ++j) {
+        int position = select_bit(available, digits[j]);
+        available &= ~(uint64_t{1} << position);
+        digits[j] = position;
+    }
+}
+
+template <typename Fn>
+bool for_each_digit_in_mask(int n, int k, const int* elements, Fn&& fn) {
+    uint64_t available = full_mask(n);
+    for (int j = 0; j < k; ++j) {
+        int element = elements[j];
+        if (element < 0 || element >= n || (available >> element & 1) == 0) {
+            return false;
+        }
+        uint64_t bit = uint64_t{1} << element;
+        fn(j, __builtin_popcountll(available & (bit - 1)));
+        available ^= bit;
+    }
+    return true;
+}
+
+#ifdef SPEEDY_HAVE_BMI2_DISPATCH
+// PDEP deposits a lone 1 at the digit-th set bit of the mask and TZCNT reads its position.
+__attribute__((target("bmi,bmi2")))
+inline void select_in_mask_bmi2(int n, int k, int* digits) {
+    uint64_t available = full_mask(n);
+    for (int j = 0; j < k; ++j) {
+        uint64_t bit = _pdep_u64(uint64_t{1} << digits[j], available);
+        available ^= bit;
+        digits[j] = static_cast<int>(_tzcnt_u64(bit));
+    }
+}
+#endif
+
+inline bool has_bmi2() {
+#ifdef SPEEDY_HAVE_BMI2_DISPATCH
+    static const bool supported = __builtin_cpu_supports("bmi2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+}  // namespace detail
+
+// Replaces falling-factorial digits with elements: through an availability mask for n <= 64
+// (PDEP when the CPU has BMI2), and through the Fenwick selector above that.
+inline void select_elements(int n, int k, int* digits) {
+    if (n <= 64) {
+#ifdef SPEEDY_HAVE_BMI2_DISPATCH
+        if (detail::has_bmi2()) {
+            detail::select_in_mask_bmi2(n, k, digits);
+            return;
+        }
+#endif
+        detail::select_in_mask_portable(n, k, digits);
+        return;
+    }
+    thread_selector(n).select(k, digits);
+}
+
+// Names the selection select_elements uses for n, for reports.
+inline const char* selection_kernel(int n) {
+    if (n > 64) {
+        return "fenwick";
+    }
+    return detail::has_bmi2() ? "pdep" : "popcount";
+}
+
+// Writes the rank-th k-permutation of {0, ..., n - 1} in lexicographic order to out, for
+// uint64_t or unsigned __int128 ranks. Ranks wrap modulo P(n, k). Returns false and writes
+// nothing when k > n, since there are no such permutations.
+template <typename Rank>
+bool unrank_permutation(int n, int k, Rank rank, int* out) {
+    if (k < 0 || k > n) {
+        return false;
+    }
+    detail::rank_digits(n, k, rank, out);
+    select_elements(n, k, out);
+    return true;
+}
+
+// The i-th k-permutation of n for the signed indices the reverse walk produces: negative
+// indices count back from P(n, k), so -1 is the last permutation.
+inline bool ithPermutation(int n, int k, int64_t i, int* out) {
+    if (k < 0 || k > n) {
+        return false;
+    }
+    if (i >= 0) {
+        detail::rank_digits(n, k, static_cast<uint64_t>(i), out);
+    } else {
+        // P(n, k) - m has the digits of m - 1 subtracted from the all-maximal digits of P(n, k) - 1.
+        detail::rank_digits(n, k, static_cast<uint64_t>(-(i + 1)), out);
+        for (int j = 0; j < k; ++j) {
+            out[j] = n - j - 1 - out[j];
+        }
+    }
+    select_elements(n, k, out);
+    return true;
+}
+
+inline std::vector<int> ithPermutation(int n, int k, int64_t i) {
+    std::vector<int> result(k >= 0 && k <= n ? k : 0);
+    ithPermutation(n, k, i, result.data());
+    return result;
+}
+
+// The inverse of unrank_permutation: the lexicographic rank of a k-permutation of n, exact
+// whenever P(n, k) fits Rank. Returns false when an element repeats or falls outside [0, n).
+template <typename Rank>
+bool rank_permutation(int n, int k, const int* permutation, Rank& rank) {
+    if (k < 0 || k > n) {
+        return false;
+    }
+    rank = 0;
+    auto accumulate = [&](int j, int digit) { rank = rank * static_cast<Rank>(n - j) + static_cast<Rank>(digit); };
+    if (n <= 64) {
+        return detail::for_each_digit_in_mask(n, k, permutation, accumulate);
+    }
+    return thread_selector(n).for_each_digit(k, permutation, accumulate);
+}
+
+// Ranks count permutations stored back to back, k ints each, across threads (0 means one per
+// hardware thread). Rows that are not valid k-permutations of n get ~Rank(0); returns how many.
+template <typename Rank>
+std::size_t rank_permutations(int n, int k, const int* permutations, std::size_t count, Rank* ranks,
+                              unsigned threads = 0) {
+    std::atomic<std::size_t> invalid{0};
+    parallel_for(count, threads, 1 << 14, [&](std::size_t begin, std::size_t end) {
+        std::size_t local_invalid = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!rank_permutation(n, k, permutations + i * k, ranks[i])) {
+                ranks[i] = ~Rank(0);
+                ++local_invalid;
+            }
+        }
+        invalid.fetch_add(local_invalid, std::memory_order_relaxed);
+    });
+    return invalid.load();
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_PERMUTATION_HPP
@@ -0,0 +1,61 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_REDUCE_HPP
+#define SPEEDY_REDUCE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+#include "speedy/parallel.hpp"
+#include "speedy/timeline.hpp"
+
+namespace speedy {
+
+// Below this many values per thread a reduction runs on the calling thread.
+constexpr std::size_t kReduceMinChunk = std::size_t{1} << 20;
+
+// The value v with no w where before(w, v), like *std::min_element with before. Chunks are
+// reduced on separate threads (0 means one per hardware thread) and merged into one result
+// under a lock, so the reduction allocates nothing. An empty range has no extremum and
+// reduces to 0; callers that need to tell it apart check the count first.
+template <typename Before>
+int reduce_values(const int* values, std::size_t count, Before before, unsigned threads = 1) {
+    if (count == 0) {
+        return 0;
+    }
+    std::mutex mutex;
+    bool merged = false;
+    int best = 0;
+    parallel_for(count, threads, kReduceMinChunk, [&](std::size_t begin, std::size_t end) {
+        int local;
+        {
+            TimelineSpan span("reduce chunk", "reduce");
+            local = *std::min_element(values + begin, values + end, before);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        TimelineSpan span("merge", "reduce");
+        best = !merged || before(local, best) ? local : best;
+        merged = true;
+    });
+    return best;
+}
+
+inline int min_value(const int* values, std::size_t count, unsigned threads = 1) {
+    return reduce_values(values, count, std::less<int>(), threads);
+}
+
+inline int max_value(const int* values, std::size_t count, unsigned threads = 1) {
+    return reduce_values(values, count, std::greater<int>(), threads);
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_REDUCE_HPP
@@ -0,0 +1,125 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_REFERENCE_HPP
+#define SPEEDY_REFERENCE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "speedy/enumerate.hpp"
+#include "speedy/permutation.hpp"
+
+namespace speedy {
+
+namespace detail {
+
+// Depth-first enumeration of k-permutations trying unused elements smallest (or largest)
+// first, i.e. plain lexicographic (or reverse) order by brute force. fn returns false to stop.
+template <typename Fn>
+bool enumerate_permutations(int n, int k, bool ascending, std::vector<int>& prefix, std::vector<char>& used,
+                            std::size_t& remaining, Fn& fn) {
+    if (static_cast<int>(prefix.size()) == k) {
+        --remaining;
+        return fn(prefix) && remaining > 0;
+    }
+    for (int step = 0; step < n; ++step) {
+        int element = ascending ? step : n - 1 - step;
+        if (used[element]) {
+            continue;
+        }
+        used[element] = 1;
+        prefix.push_back(element);
+        bool keep_going = enumerate_permutations(n, k, ascending, prefix, used, remaining, fn);
+        prefix.pop_back();
+        used[element] = 0;
+        if (!keep_going) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Fn>
+void scan_permutations(int n, int k, bool ascending, std::size_t limit, Fn&& fn) {
+    std::vector<int> prefix;
+    std::vector<char> used(n, 0);
+    if (limit > 0) {
+        enumerate_permutations(n, k, ascending, prefix, used, limit, fn);
+    }
+}
+
+}  // namespace detail
+
+// Cross-checks the unranking engine against brute force for the lowest and highest limit ranks
+// of P(n, k): ascending ranks through ithPermutation, descending ones through negative
+// indices and, where P(n, k) fits, 64- and 128-bit unrank_permutation. rank_permutation must
+// map every one back to its rank, and a PermutationCursor from rank 0 must step through them.
+inline bool verify_unranking(int n, int k, std::size_t limit, std::string& error) {
+    if (k <= 0 || k > n) {
+        return true;
+    }
+
+    uint64_t count64 = 0;
+    unsigned __int128 count128 = 0;
+    bool fits64 = permutation_count(n, k, count64);
+    bool fits128 = permutation_count(n, k, count128);
+    std::vector<int> unranked(k);
+    bool ok = true;
+
+    int64_t rank = 0;
+    PermutationCursor cursor(n, k, 0);
+    detail::scan_permutations(n, k, true, limit, [&](const std::vector<int>& expected) {
+        ithPermutation(n, k, rank, unranked.data());
+        uint64_t ranked = 0;
+        bool cursor_matches = cursor.valid() && std::equal(expected.begin(), expected.end(), cursor.data());
+        cursor.next();
+        if (unranked != expected || !cursor_matches || !rank_permutation(n, k, expected.data(), ranked) ||
+            ranked != static_cast<uint64_t>(rank)) {
+            error = "rank " + std::to_string(rank) + " of P(" + std::to_string(n) + ", " + std::to_string(k) +
+                    ") disagrees with brute force";
+            return ok = false;
+        }
+        ++rank;
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+
+    uint64_t from_top = 0;
+    detail::scan_permutations(n, k, false, limit, [&](const std::vector<int>& expected) {
+        ithPermutation(n, k, -1 - static_cast<int64_t>(from_top), unranked.data());
+        bool matches = unranked == expected;
+        if (matches && fits64) {
+            unrank_permutation(n, k, count64 - 1 - from_top, unranked.data());
+            matches = unranked == expected;
+        }
+        if (matches && fits128) {
+            unrank_permutation(n, k, count128 - 1 - from_top, unranked.data());
+            unsigned __int128 ranked = 0;
+            matches = unranked == expected && rank_permutation(n, k, expected.data(), ranked) &&
+                      ranked == count128 - 1 - from_top;
+        }
+        if (!matches) {
+            error = "rank P(" + std::to_string(n) + ", " + std::to_string(k) + ") - " + std::to_string(from_top + 1) +
+                    " disagrees with brute force";
+            return ok = false;
+        }
+        ++from_top;
+        return true;
+    });
+    return ok;
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_REFERENCE_HPP
@@ -0,0 +1,247 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_REPORT_HPP
+#define SPEEDY_REPORT_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "speedy/memory.hpp"
+#include "speedy/perf.hpp"
+#include "speedy/timeline.hpp"
+
+namespace speedy {
+
+// CPU time of the whole process, all threads included.
+inline double process_cpu_ns() {
+    timespec now{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+struct PhaseStats {
+    std::string name;
+    double wall_ns = 0;
+    double cpu_ns = 0;
+    uint64_t bytes = 0;
+    uint64_t values = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t peak_heap_bytes = 0;
+    uint64_t peak_rss_bytes = 0;
+    CounterValues counters;
+};
+
+// Collects run metadata, selected kernels and per-phase costs, and writes them as one JSON
+// object. Fields keep the order they were set in.
+class Report {
+public:
+    // A disabled report keeps PhaseScope down to one branch, for runs that do not ask for one.
+    explicit Report(bool enabled = true) : enabled_(enabled) {}
+
+    bool enabled() const { return enabled_; }
+
+    // Phases measured after this also carry the counters' readings. The report notes whether
+    // they were available, and why not.
+    void attach_counters(PerfCounters& counters) {
+        counters_ = &counters;
+        fields_.emplace_back("perf_counters", counters.available() ? "true" : quote(counters.error()));
+    }
+
+    PerfCounters* counters() const { return counters_; }
+
+    // Resets and samples VmHWM around every phase, which costs a write to /proc/self/clear_refs
+    // and a parse of /proc/self/status per phase. Off by default: the report then carries one
+    // whole-run peak_rss_bytes, sampled when it is written.
+    void track_phase_rss() { phase_rss_ = true; }
+    bool phase_rss() const { return phase_rss_; }
+
+    template <typename T>
+    void set(const std::string& key, T value) {
+        fields_.emplace_back(key, literal(value));
+    }
+
+    void set_kernel(const std::string& stage, const std::string& kernel) {
+        kernels_.emplace_back(stage, quote(kernel));
+    }
+
+    void add_phase(PhaseStats phase) { phases_.push_back(std::move(phase)); }
+
+    const std::vector<PhaseStats>& phases() const { return phases_; }
+
+    // Total wall time of the phases named name.
+    double phase_wall_ns(const std::string& name) const {
+        double total = 0;
+        for (const PhaseStats& phase : phases_) {
+            total += phase.name == name ? phase.wall_ns : 0;
+        }
+        return total;
+    }
+
+    void write_json(std::ostream& out) const {
+        out << "{\n";
+        for (const auto& field : fields_) {
+            out << "  " << quote(field.first) << ": " << field.second << ",\n";
+        }
+        if (!phase_rss_) {
+            out << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n";
+        }
+        out << "  \"kernels\": {";
+        for (std::size_t i = 0; i < kernels_.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << quote(kernels_[i].first) << ": " << kernels_[i].second;
+        }
+        out << "},\n  \"phases\": [";
+        for (std::size_t i = 0; i < phases_.size(); ++i) {
+            const PhaseStats& phase = phases_[i];
+            double seconds = phase.wall_ns / 1e9;
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << quote(phase.name)
+                << ", \"wall_ns\": " << literal(phase.wall_ns) << ", \"cpu_ns\": " << literal(phase.cpu_ns)
+                << ", \"bytes\": " << phase.bytes << ", \"values\": " << phase.values
+                << ", \"gb_per_s\": " << literal(seconds > 0 ? phase.bytes / seconds / 1e9 : 0.0)
+                << ", \"values_per_s\": " << literal(seconds > 0 ? phase.values / seconds : 0.0)
+                << ", \"memory\": {\"allocations\": " << phase.allocations
+                << ", \"allocated_bytes\": " << phase.allocated_bytes
+                << ", \"peak_heap_bytes\": " << phase.peak_heap_bytes;
+            if (phase_rss_) {
+                out << ", \"peak_rss_bytes\": " << phase.peak_rss_bytes;
+            }
+            out << "}";
+            if (!phase.counters.empty()) {
+                out << ", \"counters\": {";
+                uint64_t cycles = 0;
+                uint64_t instructions = 0;
+                for (std::size_t c = 0; c < phase.counters.size(); ++c) {
+                    const auto& counter = phase.counters[c];
+                    out << (c == 0 ? "" : ", ") << quote(counter.first) << ": " << counter.second;
+                    cycles = counter.first == "cycles" ? counter.second : cycles;
+                    instructions = counter.first == "instructions" ? counter.second : instructions;
+                }
+                if (cycles > 0 && instructions > 0) {
+                    out << ", \"ipc\": " << literal(static_cast<double>(instructions) / cycles);
+                }
+                out << "}";
+            }
+            out << "}";
+        }
+        out << (phases_.empty() ? "" : "\n  ") << "]\n}\n";
+    }
+
+private:
+    static std::string quote(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    static std::string literal(const std::string& text) { return quote(text); }
+    static std::string literal(const char* text) { return quote(text); }
+    static std::string literal(bool value) { return value ? "true" : "false"; }
+
+    template <typename T>
+    static std::enable_if_t<std::is_arithmetic_v<T>, std::string> literal(T value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.9g", static_cast<double>(value));
+            return text;
+        } else {
+            return std::to_string(value);
+        }
+    }
+
+    bool enabled_;
+    bool phase_rss_ = false;
+    PerfCounters* counters_ = nullptr;
+    std::vector<std::pair<std::string, std::string>> fields_;
+    std::vector<std::pair<std::string, std::string>> kernels_;
+    std::vector<PhaseStats> phases_;
+};
+
+// Measures wall and process CPU time, heap allocations and the heap high-water mark from
+// construction to destruction, plus the RSS high-water mark when the report tracks it, and
+// adds the phase to report, if it is enabled; it is also a span on the timeline. Allocation
+// figures need SPEEDY_COUNT_ALLOCATIONS() in the binary. Bytes and values are whatever the
+// phase reports through count().
+//
+// wall_ns and cpu_ns cover only the phase body: the snapshots, /proc probes and counter
+// start/stop happen outside them. A timer wrapped around the whole scope still sees that cost.
+class PhaseScope {
+public:
+    PhaseScope(Report& report, const char* name) : report_(report), span_(name, "phase") {
+        if (report_.enabled()) {
+            phase_.name = name;
+            allocations_start_ = allocation_snapshot();
+            reset_peak_heap();
+            if (report_.phase_rss()) {
+                reset_peak_rss();
+            }
+            if (report_.counters() != nullptr) {
+                report_.counters()->start();
+            }
+            cpu_start_ = process_cpu_ns();
+            wall_start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseScope() {
+        if (!report_.enabled()) {
+            return;
+        }
+        phase_.wall_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start_).count();
+        phase_.cpu_ns = process_cpu_ns() - cpu_start_;
+        if (report_.counters() != nullptr) {
+            phase_.counters = report_.counters()->stop();
+        }
+        AllocationSnapshot allocations = allocation_snapshot();
+        phase_.allocations = allocations.allocations - allocations_start_.allocations;
+        phase_.allocated_bytes = allocations.bytes - allocations_start_.bytes;
+        phase_.peak_heap_bytes = peak_heap_bytes();
+        if (report_.phase_rss()) {
+            phase_.peak_rss_bytes = peak_rss_bytes();
+        }
+        report_.add_phase(std::move(phase_));
+    }
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+    void count(uint64_t bytes, uint64_t values) {
+        phase_.bytes = bytes;
+        phase_.values = values;
+    }
+
+private:
+    Report& report_;
+    TimelineSpan span_;
+    PhaseStats phase_;
+    AllocationSnapshot allocations_start_{};
+    double cpu_start_ = 0;
+    std::chrono::steady_clock::time_point wall_start_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_REPORT_HPP
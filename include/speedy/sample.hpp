@@ -0,0 +1,173 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_SAMPLE_HPP
+#define SPEEDY_SAMPLE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "speedy/packed.hpp"
+#include "speedy/parallel.hpp"
+#include "speedy/permutation.hpp"
+
+namespace speedy {
+
+// xoshiro256** (Blackman and Vigna). Each stream is seeded through splitmix64 from the seed and
+// a stream number, so streams drawn from one seed do not overlap in practice.
+class Xoshiro256 {
+public:
+    Xoshiro256(uint64_t seed, uint64_t stream) {
+        uint64_t x = mix(seed ^ mix(stream + kGolden));
+        for (auto& word : state_) {
+            x += kGolden;
+            word = mix(x);
+        }
+    }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+private:
+    static constexpr uint64_t kGolden = 0x9e3779b97f4a7c15ull;
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t state_[4];
+};
+
+// Uniform in [0, bound) for bound >= 1 by Lemire's multiply-and-reject: the high half of
+// x * bound, redrawing only when the low half lands in the biased sliver, so the modulo that
+// sizes the sliver is only computed on the rare near-miss.
+template <typename Rng>
+uint64_t uniform_below(Rng& rng, uint64_t bound) {
+    unsigned __int128 product = static_cast<unsigned __int128>(rng()) * bound;
+    uint64_t low = static_cast<uint64_t>(product);
+    if (low < bound) {
+        uint64_t threshold = -bound % bound;
+        while (low < threshold) {
+            product = static_cast<unsigned __int128>(rng()) * bound;
+            low = static_cast<uint64_t>(product);
+        }
+    }
+    return static_cast<uint64_t>(product >> 64);
+}
+
+// Samples are drawn in fixed blocks, each from its own stream, so the output for a seed is the
+// same whatever the thread count.
+constexpr std::size_t kSampleBlock = 1 << 12;
+
+namespace detail {
+
+template <typename Fn>
+void for_each_sample_block(std::size_t count, uint64_t seed, unsigned threads, Fn&& fn) {
+    std::size_t blocks = (count + kSampleBlock - 1) / kSampleBlock;
+    parallel_for(blocks, threads, 4, [&](std::size_t first, std::size_t last) {
+        for (std::size_t block = first; block < last; ++block) {
+            Xoshiro256 rng(seed, block);
+            std::size_t begin = block * kSampleBlock;
+            fn(rng, begin, std::min(count, begin + kSampleBlock));
+        }
+    });
+}
+
+// Uniform falling-factorial digits: each digit is uniform over its own radix and independent
+// of the others, which is exactly a uniform rank when P(n, k) is too large for one draw.
+template <typename Rng>
+void sample_digits(Rng& rng, int n, int k, int* digits) {
+    for (int j = 0; j < k; ++j) {
+        digits[j] = static_cast<int>(uniform_below(rng, static_cast<uint64_t>(n - j)));
+    }
+}
+
+}  // namespace detail
+
+// Fills ranks with count uniform ranks in [0, P(n, k)). Returns false, writing nothing, when
+// k > n or P(n, k) does not fit 64 bits.
+inline bool sample_ranks(int n, int k, std::size_t count, uint64_t seed, uint64_t* ranks, unsigned threads = 0) {
+    uint64_t total = 0;
+    if (k < 0 || k > n || !permutation_count(n, k, total)) {
+        return false;
+    }
+    detail::for_each_sample_block(count, seed, threads, [&](Xoshiro256& rng, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            ranks[i] = uniform_below(rng, total);
+        }
+    });
+    return true;
+}
+
+// Writes count uniform k-permutations of n to out, k ints each. When P(n, k) fits 64 bits one
+// draw picks a rank that is then unranked; above that each digit is drawn on its own. Returns
+// false, writing nothing, when k > n.
+inline bool sample_permutations(int n, int k, std::size_t count, uint64_t seed, int* out, unsigned threads = 0) {
+    if (k < 0 || k > n) {
+        return false;
+    }
+    uint64_t total = 0;
+    bool ranked = permutation_count(n, k, total);
+    detail::for_each_sample_block(count, seed, threads, [&](Xoshiro256& rng, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            int* row = out + i * k;
+            if (ranked) {
+                detail::rank_digits(n, k, uniform_below(rng, total), row);
+            } else {
+                detail::sample_digits(rng, n, k, row);
+            }
+            select_elements(n, k, row);
+        }
+    });
+    return true;
+}
+
+// As sample_permutations, packed into out (resized to count rows). out must be an arena for the
+// same n and k.
+inline bool sample_permutations(std::size_t count, uint64_t seed, PermutationArena& out, unsigned threads = 0) {
+    int n = out.n();
+    int k = out.k();
+    if (k < 0 || k > n) {
+        return false;
+    }
+    out.resize(count);
+    uint64_t total = 0;
+    bool ranked = permutation_count(n, k, total);
+    detail::for_each_sample_block(count, seed, threads, [&](Xoshiro256& rng, std::size_t begin, std::size_t end) {
+        std::vector<int> row(k);
+        for (std::size_t i = begin; i < end; ++i) {
+            if (ranked) {
+                detail::rank_digits(n, k, uniform_below(rng, total), row.data());
+            } else {
+                detail::sample_digits(rng, n, k, row.data());
+            }
+            select_elements(n, k, row.data());
+            out.set(i, row.data());
+        }
+    });
+    return true;
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_SAMPLE_HPP
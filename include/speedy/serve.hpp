@@ -0,0 +1,223 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_SERVE_HPP
+#define SPEEDY_SERVE_HPP
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace speedy {
+
+// Wire protocol of speedy_serve. A client sends fixed 24-byte requests over a Unix stream
+// socket and gets back, in order, a fixed 24-byte response header followed by payload_bytes of
+// payload. Fields are little-endian, like the layer file format, and requests may be pipelined.
+// The server stops reading from a client that has too many responses waiting, so a pipelining
+// client must read responses as it goes.
+enum class ServeOp : uint8_t {
+    list = 0,   // payload: dataset names, one per line, in id order
+    min = 1,    // value: smallest value; payload: its layer-0 permutation as int32s
+    max = 2,    // value: largest value; payload: its layer-0 permutation as int32s
+    rank = 3,   // value: values < a; extra: values == a
+    top_k = 4,  // payload: the limit smallest values ascending, or largest descending with kServeLargest
+    range = 5,  // value: values in [a, b]; payload: up to limit of them ascending
+};
+
+// Most int32s one payload carries, so payload_bytes fits 32 bits; larger limits are clamped.
+constexpr uint32_t kServeMaxValues = UINT32_MAX / sizeof(int32_t);
+
+enum class ServeStatus : uint8_t {
+    ok = 0,
+    bad_request = 1,
+    unknown_dataset = 2,
+    empty_dataset = 3,
+};
+
+constexpr uint8_t kServeLargest = 1;
+
+struct ServeRequest {
+    ServeOp op;
+    uint8_t flags;
+    uint16_t dataset;
+    uint32_t limit;
+    int64_t a;
+    int64_t b;
+};
+
+struct ServeResponse {
+    ServeStatus status;
+    uint8_t reserved[3];
+    uint32_t payload_bytes;
+    int64_t value;
+    int64_t extra;
+};
+
+static_assert(sizeof(ServeRequest) == 24, "ServeRequest is sent as raw bytes");
+static_assert(sizeof(ServeResponse) == 24, "ServeResponse is sent as raw bytes");
+
+inline const char* serve_status_name(ServeStatus status) {
+    switch (status) {
+        case ServeStatus::ok:
+            return "ok";
+        case ServeStatus::bad_request:
+            return "bad request";
+        case ServeStatus::unknown_dataset:
+            return "unknown dataset";
+        case ServeStatus::empty_dataset:
+            return "empty dataset";
+    }
+    return "unknown status";
+}
+
+// Blocking client for one connection. Every call sends one request and waits for its answer;
+// errors from the server are thrown as std::runtime_error.
+class ServeClient {
+public:
+    explicit ServeClient(const std::string& socket_path) {
+        sockaddr_un address{};
+        if (socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path too long: " + socket_path);
+        }
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            int error = errno;
+            ::close(fd_);
+            throw std::runtime_error("cannot connect to " + socket_path + ": " + std::strerror(error));
+        }
+    }
+
+    ServeClient(const ServeClient&) = delete;
+    ServeClient& operator=(const ServeClient&) = delete;
+
+    ~ServeClient() { ::close(fd_); }
+
+    std::vector<std::string> list() {
+        call({ServeOp::list, 0, 0, 0, 0, 0});
+        std::vector<std::string> names;
+        std::size_t start = 0;
+        while (start < payload_.size()) {
+            std::size_t end = start;
+            while (end < payload_.size() && payload_[end] != '\n') {
+                ++end;
+            }
+            names.emplace_back(payload_.data() + start, end - start);
+            start = end + 1;
+        }
+        return names;
+    }
+
+    // Smallest or largest value of a dataset, with its layer-0 permutation.
+    int64_t min(uint16_t dataset, std::vector<int32_t>* permutation = nullptr) {
+        return extremum(ServeOp::min, dataset, permutation);
+    }
+
+    int64_t max(uint16_t dataset, std::vector<int32_t>* permutation = nullptr) {
+        return extremum(ServeOp::max, dataset, permutation);
+    }
+
+    // Values below value, and optionally how many equal it.
+    int64_t rank(uint16_t dataset, int64_t value, int64_t* equal = nullptr) {
+        ServeResponse response = call({ServeOp::rank, 0, dataset, 0, value, 0});
+        if (equal != nullptr) {
+            *equal = response.extra;
+        }
+        return response.value;
+    }
+
+    std::vector<int32_t> top_k(uint16_t dataset, uint32_t k, bool largest = false) {
+        call({ServeOp::top_k, largest ? kServeLargest : uint8_t{0}, dataset, k, 0, 0});
+        return payload_ints();
+    }
+
+    // Values in [low, high]; returns the full count and fills values with up to limit of them.
+    int64_t range(uint16_t dataset, int64_t low, int64_t high, uint32_t limit, std::vector<int32_t>* values = nullptr) {
+        ServeResponse response = call({ServeOp::range, 0, dataset, limit, low, high});
+        if (values != nullptr) {
+            *values = payload_ints();
+        }
+        return response.value;
+    }
+
+private:
+    int64_t extremum(ServeOp op, uint16_t dataset, std::vector<int32_t>* permutation) {
+        ServeResponse response = call({op, 0, dataset, 0, 0, 0});
+        if (permutation != nullptr) {
+            *permutation = payload_ints();
+        }
+        return response.value;
+    }
+
+    ServeResponse call(const ServeRequest& request) {
+        write_all(&request, sizeof(request));
+        ServeResponse response{};
+        read_all(&response, sizeof(response));
+        payload_.resize(response.payload_bytes);
+        read_all(payload_.data(), payload_.size());
+        if (response.status != ServeStatus::ok) {
+            throw std::runtime_error(std::string("speedy_serve: ") + serve_status_name(response.status));
+        }
+        return response;
+    }
+
+    std::vector<int32_t> payload_ints() const {
+        std::vector<int32_t> values(payload_.size() / sizeof(int32_t));
+        std::memcpy(values.data(), payload_.data(), values.size() * sizeof(int32_t));
+        return values;
+    }
+
+    void write_all(const void* data, std::size_t size) {
+        const char* cursor = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::send(fd_, cursor, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+            }
+            cursor += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    void read_all(void* data, std::size_t size) {
+        char* cursor = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t read = ::recv(fd_, cursor, size, 0);
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                throw std::runtime_error(read == 0 ? "speedy_serve closed the connection"
+                                                   : std::string("recv: ") + std::strerror(errno));
+            }
+            cursor += read;
+            size -= static_cast<std::size_t>(read);
+        }
+    }
+
+    int fd_ = -1;
+    std::vector<char> payload_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_SERVE_HPP
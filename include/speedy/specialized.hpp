@@ -0,0 +1,127 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_SPECIALIZED_HPP
+#define SPEEDY_SPECIALIZED_HPP
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "speedy/layers.hpp"
+#include "speedy/permutation.hpp"
+
+// The (n, k) pairs that get a fully unrolled layer chain. Override at compile time, e.g.
+// -D'SPEEDY_SPECIALIZED_SHAPES(X)=X(12, 3) X(8, 6)'. Every pair needs k <= n.
+#ifndef SPEEDY_SPECIALIZED_SHAPES
+#define SPEEDY_SPECIALIZED_SHAPES(X) X(10, 6) X(16, 4) X(26, 5) X(64, 8) X(100, 5)
+#endif
+
+namespace speedy {
+
+namespace detail {
+
+template <int Depth>
+inline int64_t fold_layers(int64_t value) {
+    if constexpr (Depth == 0) {
+        return value;
+    } else {
+        return fold_layers<Depth - 1>((value - 1 - Depth) / 2);
+    }
+}
+
+// Falling-factorial digits with every radix a constant, least significant digit first.
+template <int N, int K, int... J>
+inline void unroll_digits(uint64_t rank, int* out, std::integer_sequence<int, J...>) {
+    ((out[K - 1 - J] = static_cast<int>(rank % (N - K + 1 + J)), rank /= (N - K + 1 + J)), ...);
+}
+
+}  // namespace detail
+
+// The runtime ithPermutation with N and K baked in, so every radix division is by a constant.
+template <int N, int K>
+inline void ithPermutation(int64_t i, int* out) {
+    static_assert(K > 0 && K <= N, "k-permutations of n need 0 < k <= n");
+
+    if (i >= 0) {
+        detail::unroll_digits<N, K>(static_cast<uint64_t>(i), out, std::make_integer_sequence<int, K>{});
+    } else {
+        detail::unroll_digits<N, K>(static_cast<uint64_t>(-(i + 1)), out, std::make_integer_sequence<int, K>{});
+        for (int j = 0; j < K; ++j) {
+            out[j] = N - j - 1 - out[j];
+        }
+    }
+
+    select_elements(N, K, out);
+}
+
+// Layer walk and unranking for one (n, k) with the depth and every divisor folded in.
+template <int N, int K>
+struct ShapeChain {
+    static constexpr int kDepth = layer_count(N, K);
+    static_assert(kDepth >= 0, "n^k too wide for a specialized chain");
+
+    static void reverse(int value, int* permutation) {
+        ithPermutation<N, K>(detail::fold_layers<kDepth>(value), permutation);
+    }
+};
+
+struct ShapeKernel {
+    int n;
+    int k;
+    int layer_depth;
+    void (*reverse)(int value, int* permutation);
+};
+
+inline const std::vector<ShapeKernel>& specialized_shapes() {
+#define SPEEDY_SHAPE_ENTRY(N, K) ShapeKernel{N, K, ShapeChain<N, K>::kDepth, &ShapeChain<N, K>::reverse},
+    static const std::vector<ShapeKernel> table = {SPEEDY_SPECIALIZED_SHAPES(SPEEDY_SHAPE_ENTRY)};
+#undef SPEEDY_SHAPE_ENTRY
+    return table;
+}
+
+inline const ShapeKernel* find_specialized(int n, int k, int layer_depth) {
+    for (const auto& kernel : specialized_shapes()) {
+        if (kernel.n == n && kernel.k == k && kernel.layer_depth == layer_depth) {
+            return &kernel;
+        }
+    }
+    return nullptr;
+}
+
+// Picks the specialized chain for (n, k) once at startup and falls back to the composed
+// LayerPlan with the runtime unranker for every other shape.
+class ShapeDispatch {
+public:
+    ShapeDispatch(int n, int k, int layer_depth)
+        : n_(n), k_(k), plan_(layer_depth), kernel_(find_specialized(n, k, layer_depth)) {}
+
+    bool specialized() const { return kernel_ != nullptr; }
+    // Ints written per permutation: k, or 0 when k > n and there is nothing to unrank.
+    int width() const { return k_ <= n_ ? k_ : 0; }
+    const LayerPlan& plan() const { return plan_; }
+
+    void reverse(int value, int* permutation) const {
+        if (kernel_ != nullptr) {
+            kernel_->reverse(value, permutation);
+        } else {
+            ithPermutation(n_, k_, static_cast<int>(plan_.apply(value)), permutation);
+        }
+    }
+
+private:
+    int n_;
+    int k_;
+    LayerPlan plan_;
+    const ShapeKernel* kernel_;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_SPECIALIZED_HPP
@@ -0,0 +1,137 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_TABLES_HPP
+#define SPEEDY_TABLES_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "speedy/layers.hpp"
+
+namespace speedy {
+
+// Radices, falling factorials and reciprocals are tabulated for n up to kTableMaxN.
+constexpr int kTableMaxN = 256;
+// 21! already exceeds 2^64, so no P(n, k) with k > 20 fits a 64-bit rank.
+constexpr int kTableMaxK = 20;
+// Layer counts are tabulated for n up to kTableMaxN and k up to kLayerTableMaxK.
+constexpr int kLayerTableMaxK = 64;
+
+// Division by a fixed 32-bit divisor as a multiply-high and two shifts (Granlund and
+// Montgomery, "Division by Invariant Integers using Multiplication", figure 4.1). Exact for
+// every 64-bit dividend.
+struct Reciprocal {
+    uint64_t multiplier = 0;
+    uint32_t divisor = 0;
+    uint8_t shift1 = 0;
+    uint8_t shift2 = 0;
+
+    constexpr Reciprocal() = default;
+
+    constexpr explicit Reciprocal(uint32_t d) : divisor(d) {
+        int log = 0;
+        while ((uint64_t{1} << log) < d) {
+            ++log;
+        }
+        unsigned __int128 numerator = static_cast<unsigned __int128>((uint64_t{1} << log) - d) << 64;
+        multiplier = static_cast<uint64_t>(numerator / d) + 1;
+        shift1 = log < 1 ? log : 1;
+        shift2 = log > 1 ? log - 1 : 0;
+    }
+
+    constexpr uint64_t divide(uint64_t x) const {
+        uint64_t high = static_cast<uint64_t>((static_cast<unsigned __int128>(multiplier) * x) >> 64);
+        return (high + ((x - high) >> shift1)) >> shift2;
+    }
+};
+
+namespace detail {
+
+constexpr std::array<Reciprocal, kTableMaxN + 1> make_reciprocals() {
+    std::array<Reciprocal, kTableMaxN + 1> table{};
+    for (int d = 1; d <= kTableMaxN; ++d) {
+        table[d] = Reciprocal(static_cast<uint32_t>(d));
+    }
+    return table;
+}
+
+// Largest k whose P(n, k) fits 64 bits, capped at n.
+constexpr std::array<uint8_t, kTableMaxN + 1> make_max_exact_k() {
+    std::array<uint8_t, kTableMaxN + 1> table{};
+    for (int n = 0; n <= kTableMaxN; ++n) {
+        unsigned __int128 count = 1;
+        int k = 0;
+        while (k < n && count * static_cast<unsigned>(n - k) <= ~uint64_t{0}) {
+            count *= static_cast<unsigned>(n - k);
+            ++k;
+        }
+        table[n] = static_cast<uint8_t>(k);
+    }
+    return table;
+}
+
+constexpr std::array<std::array<uint64_t, kTableMaxK + 1>, kTableMaxN + 1> make_falling_factorials() {
+    std::array<std::array<uint64_t, kTableMaxK + 1>, kTableMaxN + 1> table{};
+    constexpr auto max_k = make_max_exact_k();
+    for (int n = 0; n <= kTableMaxN; ++n) {
+        table[n][0] = 1;
+        for (int k = 1; k <= max_k[n]; ++k) {
+            table[n][k] = table[n][k - 1] * static_cast<uint64_t>(n - k + 1);
+        }
+    }
+    return table;
+}
+
+// layer_count for each n, carrying n^k from one k to the next instead of recomputing it: the
+// bit length of n^k - 1 is that of n^k, less one when n is a power of two.
+constexpr std::array<std::array<uint16_t, kLayerTableMaxK + 1>, kTableMaxN + 1> make_layer_counts() {
+    std::array<std::array<uint16_t, kLayerTableMaxK + 1>, kTableMaxN + 1> table{};
+    constexpr int kLimbs = (kLayerTableMaxK * 9 + 31) / 32;
+    for (int n = 2; n <= kTableMaxN; ++n) {
+        uint32_t limbs[kLimbs] = {1};
+        int used = 1;
+        bool power_of_two = (n & (n - 1)) == 0;
+        for (int k = 1; k <= kLayerTableMaxK; ++k) {
+            uint64_t carry = 0;
+            for (int i = 0; i < used; ++i) {
+                uint64_t product = static_cast<uint64_t>(limbs[i]) * static_cast<uint32_t>(n) + carry;
+                limbs[i] = static_cast<uint32_t>(product);
+                carry = product >> 32;
+            }
+            if (carry != 0) {
+                limbs[used++] = static_cast<uint32_t>(carry);
+            }
+            int bits = (used - 1) * 32;
+            for (uint32_t top = limbs[used - 1]; top != 0; top >>= 1) {
+                ++bits;
+            }
+            table[n][k] = static_cast<uint16_t>(bits - (power_of_two ? 1 : 0));
+        }
+    }
+    return table;
+}
+
+}  // namespace detail
+
+constexpr auto kReciprocals = detail::make_reciprocals();
+constexpr auto kMaxExactK = detail::make_max_exact_k();
+constexpr auto kFallingFactorials = detail::make_falling_factorials();
+constexpr auto kLayerCounts = detail::make_layer_counts();
+
+// layer_count from the table when (n, k) is in range, computed otherwise.
+inline int layers_for(int n, int k) {
+    if (n >= 0 && n <= kTableMaxN && k >= 0 && k <= kLayerTableMaxK) {
+        return kLayerCounts[n][k];
+    }
+    return layer_count(n, k);
+}
+
+}  // namespace speedy
+
+#endif  // SPEEDY_TABLES_HPP
@@ -0,0 +1,133 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_TIMELINE_HPP
+#define SPEEDY_TIMELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace speedy {
+
+// Spans of work per thread, exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+// Each thread appends to its own buffer without locking; buffers outlive their threads and are
+// only walked when the trace is written, after the workers have been joined.
+class Timeline {
+public:
+    struct Span {
+        const char* name;
+        const char* category;
+        int64_t start_ns;
+        int64_t end_ns;
+    };
+
+    static Timeline& instance() {
+        static Timeline timeline;
+        return timeline;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void enable() {
+        origin_ = std::chrono::steady_clock::now();
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+
+    int64_t now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_)
+            .count();
+    }
+
+    void record(const char* name, const char* category, int64_t start_ns, int64_t end_ns) {
+        thread_buffer().spans.push_back(Span{name, category, start_ns, end_ns});
+    }
+
+    bool write(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(path);
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        bool first = true;
+        for (const auto& buffer : buffers_) {
+            out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << buffer->id << ", \"args\": {\"name\": \"" << (buffer->id == 0 ? "main" : "worker ")
+                << (buffer->id == 0 ? "" : std::to_string(buffer->id)) << "\"}}";
+            first = false;
+            for (const Span& span : buffer->spans) {
+                out << ",\n{\"name\": \"" << span.name << "\", \"cat\": \"" << span.category
+                    << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id << ", \"ts\": " << span.start_ns / 1e3
+                    << ", \"dur\": " << (span.end_ns - span.start_ns) / 1e3 << "}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct ThreadBuffer {
+        int id;
+        std::vector<Span> spans;
+    };
+
+    // Thread ids follow first use; the thread that enables the timeline normally records first.
+    ThreadBuffer& thread_buffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers_.back().get();
+            buffer->id = static_cast<int>(buffers_.size() - 1);
+            buffer->spans.reserve(1024);
+        }
+        return *buffer;
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::chrono::steady_clock::time_point origin_ = std::chrono::steady_clock::now();
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records its own lifetime as a span on the calling thread while the timeline is enabled.
+// name and category must be string literals or otherwise outlive the trace.
+class TimelineSpan {
+public:
+    TimelineSpan(const char* name, const char* category)
+        : name_(name), category_(category), active_(Timeline::instance().enabled()) {
+        if (active_) {
+            start_ns_ = Timeline::instance().now_ns();
+        }
+    }
+
+    ~TimelineSpan() {
+        if (active_) {
+            Timeline& timeline = Timeline::instance();
+            timeline.record(name_, category_, start_ns_, timeline.now_ns());
+        }
+    }
+
+    TimelineSpan(const TimelineSpan&) = delete;
+    TimelineSpan& operator=(const TimelineSpan&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    bool active_;
+    int64_t start_ns_ = 0;
+};
+
+}  // namespace speedy
+
+#endif  // SPEEDY_TIMELINE_HPP
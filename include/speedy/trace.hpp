@@ -0,0 +1,184 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPEEDY_TRACE_HPP
+#define SPEEDY_TRACE_HPP
+
+// Per-layer latency tracing on the time-stamp counter. Build with -DSPEEDY_TRACE=0 to compile
+// every SPEEDY_TRACE_LAYER out; otherwise tracing costs one branch until enabled at runtime.
+#ifndef SPEEDY_TRACE
+#define SPEEDY_TRACE 1
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace speedy {
+
+// RDTSCP waits for earlier instructions to retire before reading the counter. Other targets
+// fall back to steady_clock nanoseconds.
+inline uint64_t trace_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Counter ticks per nanosecond, measured once against steady_clock over a few milliseconds.
+inline double trace_ticks_per_ns() {
+    static const double ratio = [] {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t first = trace_clock();
+        auto now = start;
+        while (now - start < std::chrono::milliseconds(5)) {
+            now = std::chrono::steady_clock::now();
+        }
+        uint64_t last = trace_clock();
+        double elapsed = std::chrono::duration<double, std::nano>(now - start).count();
+        return static_cast<double>(last - first) / elapsed;
+    }();
+    return ratio;
+}
+
+struct LayerLatency {
+    int layer;
+    std::size_t samples;
+    double min_ns;
+    double median_ns;
+    double p99_ns;
+};
+
+// Records (layer, ticks) pairs into a preallocated ring that keeps the newest capacity events.
+// Not synchronized: trace from one thread at a time.
+class LayerTracer {
+public:
+    bool enabled() const { return enabled_; }
+
+    // Allocates the ring (rounded up to a power of two) and measures the cost of an empty
+    // span, which summary() subtracts from every sample.
+    void enable(std::size_t capacity = std::size_t{1} << 20) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        events_.assign(size, Event{});
+        head_ = 0;
+        overhead_ = ~uint64_t{0};
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t start = trace_clock();
+            overhead_ = std::min(overhead_, trace_clock() - start);
+        }
+        trace_ticks_per_ns();
+        enabled_ = true;
+    }
+
+    void disable() { enabled_ = false; }
+
+    void record(int layer, uint64_t ticks) {
+        events_[head_++ & (events_.size() - 1)] = Event{layer, ticks};
+    }
+
+    std::vector<LayerLatency> summary() const {
+        std::size_t count = std::min<std::size_t>(head_, events_.size());
+        std::vector<std::vector<uint64_t>> by_layer;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Event& event = events_[i];
+            if (event.layer < 0) {
+                continue;
+            }
+            if (static_cast<std::size_t>(event.layer) >= by_layer.size()) {
+                by_layer.resize(event.layer + 1);
+            }
+            by_layer[event.layer].push_back(event.ticks > overhead_ ? event.ticks - overhead_ : 0);
+        }
+
+        double ticks_per_ns = trace_ticks_per_ns();
+        std::vector<LayerLatency> result;
+        for (std::size_t layer = 0; layer < by_layer.size(); ++layer) {
+            std::vector<uint64_t>& ticks = by_layer[layer];
+            if (ticks.empty()) {
+                continue;
+            }
+            std::sort(ticks.begin(), ticks.end());
+            auto at = [&](double quantile) {
+                return ticks[static_cast<std::size_t>(quantile * (ticks.size() - 1))] / ticks_per_ns;
+            };
+            result.push_back(LayerLatency{static_cast<int>(layer), ticks.size(), at(0.0), at(0.5), at(0.99)});
+        }
+        return result;
+    }
+
+private:
+    struct Event {
+        int layer = -1;
+        uint64_t ticks = 0;
+    };
+
+    bool enabled_ = false;
+    std::size_t head_ = 0;
+    uint64_t overhead_ = 0;
+    std::vector<Event> events_;
+};
+
+// One line per layer, deepest first.
+inline void write_layer_latencies(std::ostream& out, const std::vector<LayerLatency>& latencies) {
+    for (auto it = latencies.rbegin(); it != latencies.rend(); ++it) {
+        out << "layer " << it->layer << ": min " << it->min_ns << " ns, median " << it->median_ns << " ns, p99 "
+            << it->p99_ns << " ns (" << it->samples << " samples)\n";
+    }
+}
+
+inline LayerTracer& layer_tracer() {
+    static LayerTracer tracer;
+    return tracer;
+}
+
+// Times its own lifetime and records it against layer when the tracer is enabled.
+class TraceScope {
+public:
+    explicit TraceScope(int layer) : layer_(layer), active_(layer_tracer().enabled()) {
+        if (active_) {
+            start_ = trace_clock();
+        }
+    }
+
+    ~TraceScope() {
+        if (active_) {
+            layer_tracer().record(layer_, trace_clock() - start_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    int layer_;
+    bool active_;
+    uint64_t start_ = 0;
+};
+
+}  // namespace speedy
+
+#if SPEEDY_TRACE
+#define SPEEDY_TRACE_LAYER(layer) ::speedy::TraceScope speedy_trace_scope_(layer)
+#else
+#define SPEEDY_TRACE_LAYER(layer) static_cast<void>(0)
+#endif
+
+#endif  // SPEEDY_TRACE_HPP
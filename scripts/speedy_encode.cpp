@@ -0,0 +1,208 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <charconv>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "cxxopts.hpp"
+#include "speedy/binary_format.hpp"
+#include "speedy/exact.hpp"
+#include "speedy/layers.hpp"
+#include "speedy/parallel.hpp"
+
+// Reads the first column of a CSV as unsigned integers, a block at a time, so inputs far
+// larger than memory stream through. Lines that do not start with a digit are skipped.
+class CsvChunkReader {
+public:
+    explicit CsvChunkReader(const std::string& path) : file_(std::fopen(path.c_str(), "rb")), block_(1 << 20) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open " + path);
+        }
+    }
+
+    ~CsvChunkReader() { std::fclose(file_); }
+
+    std::size_t bytes_read() const { return bytes_read_; }
+
+    bool next(std::vector<uint64_t>& chunk, std::size_t max_values) {
+        chunk.clear();
+        while (chunk.size() < max_values) {
+            std::size_t newline = pending_.find('\n', cursor_);
+            if (newline == std::string::npos) {
+                if (!refill()) {
+                    if (cursor_ < pending_.size()) {
+                        parse_line(pending_.data() + cursor_, pending_.data() + pending_.size(), chunk);
+                        cursor_ = pending_.size();
+                    }
+                    break;
+                }
+                continue;
+            }
+            parse_line(pending_.data() + cursor_, pending_.data() + newline, chunk);
+            cursor_ = newline + 1;
+        }
+        return !chunk.empty();
+    }
+
+private:
+    bool refill() {
+        pending_.erase(0, cursor_);
+        cursor_ = 0;
+        std::size_t read = std::fread(block_.data(), 1, block_.size(), file_);
+        bytes_read_ += read;
+        pending_.append(block_.data(), read);
+        return read > 0;
+    }
+
+    static void parse_line(const char* begin, const char* end, std::vector<uint64_t>& chunk) {
+        uint64_t value = 0;
+        auto parsed = std::from_chars(begin, end, value);
+        if (parsed.ec == std::errc()) {
+            chunk.push_back(value);
+        }
+    }
+
+    std::FILE* file_;
+    std::vector<char> block_;
+    std::string pending_;
+    std::size_t cursor_ = 0;
+    std::size_t bytes_read_ = 0;
+};
+
+template <typename Word>
+uint64_t encode_stream(CsvChunkReader& reader, const std::vector<int>& layers, const std::string& out_prefix,
+                       int value_bits, std::size_t chunk_values, unsigned threads) {
+    std::vector<std::unique_ptr<speedy::LayerFileWriter>> writers;
+    for (int layer : layers) {
+        writers.push_back(std::make_unique<speedy::LayerFileWriter>(
+            out_prefix + ".layer" + std::to_string(layer) + ".bin", speedy::word_bytes<Word>(), layer));
+    }
+
+    std::vector<uint64_t> chunk;
+    std::vector<std::vector<Word>> encoded(layers.size());
+    std::vector<std::vector<char>> bytes(layers.size());
+    uint64_t total = 0;
+
+    while (reader.next(chunk, chunk_values)) {
+        for (uint64_t value : chunk) {
+            if (value_bits < 64 && (value >> value_bits) != 0) {
+                throw std::out_of_range(std::to_string(value) + " is wider than n^k");
+            }
+        }
+
+        auto encode_layer = [&](std::size_t slot, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                encoded[slot][i] = speedy::encode_layers_exact(Word(chunk[i]), layers[slot]);
+            }
+        };
+
+        if (layers.size() == 1) {
+            // One layer: split the chunk across threads, then write it in one go.
+            encoded[0].resize(chunk.size());
+            speedy::parallel_for(chunk.size(), threads, 1 << 14, [&](std::size_t begin, std::size_t end) {
+                encode_layer(0, begin, end);
+            });
+            bytes[0].clear();
+            speedy::append_words(encoded[0].data(), encoded[0].size(), bytes[0]);
+            writers[0]->append(bytes[0]);
+        } else {
+            // Every layer: each thread owns whole layers, encoding and writing its own files.
+            speedy::parallel_for(layers.size(), threads, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t slot = begin; slot < end; ++slot) {
+                    encoded[slot].resize(chunk.size());
+                    encode_layer(slot, 0, chunk.size());
+                    bytes[slot].clear();
+                    speedy::append_words(encoded[slot].data(), encoded[slot].size(), bytes[slot]);
+                    writers[slot]->append(bytes[slot]);
+                }
+            });
+        }
+        total += chunk.size();
+    }
+
+    for (auto& writer : writers) {
+        writer->close();
+    }
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("speedy-encode", "Encode raw values into layered binary inputs for the reverse path");
+
+    options.add_options()
+        ("n", "Total number of elements", cxxopts::value<int>())
+        ("k", "Number of elements in the permutation", cxxopts::value<int>())
+        ("csv", "Path to the CSV file of raw values", cxxopts::value<std::string>())
+        ("out", "Output prefix; layer D is written to <out>.layerD.bin", cxxopts::value<std::string>())
+        ("layer", "Write only this layer instead of layers 1..l", cxxopts::value<int>())
+        ("threads", "Worker threads (0 = all cores)", cxxopts::value<unsigned>()->default_value("0"))
+        ("chunk", "Values read per chunk", cxxopts::value<std::size_t>()->default_value("1048576"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    int n = result["n"].as<int>();
+    int k = result["k"].as<int>();
+    int l = speedy::layer_count(n, k);
+    if (l < 1) {
+        std::cerr << "n^k must be at least 2 and at most 2^2048 to have layers to encode" << std::endl;
+        return 1;
+    }
+
+    std::vector<int> layers;
+    if (result.count("layer")) {
+        int layer = result["layer"].as<int>();
+        if (layer < 1 || layer > l) {
+            std::cerr << "--layer must be between 1 and " << l << " for n = " << n << ", k = " << k << std::endl;
+            return 1;
+        }
+        layers.push_back(layer);
+    } else {
+        for (int layer = 1; layer <= l; ++layer) {
+            layers.push_back(layer);
+        }
+    }
+
+    // Raw values run up to n^k, which takes one bit more than l when n^k is a power of two.
+    int value_bits = l + 1;
+    int deepest = *std::max_element(layers.begin(), layers.end());
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t total = 0;
+    try {
+        CsvChunkReader reader(result["csv"].as<std::string>());
+        total = speedy::with_exact_tier(value_bits + 2, deepest, [&](auto zero) {
+            return encode_stream<decltype(zero)>(reader, layers, result["out"].as<std::string>(), value_bits,
+                                                 result["chunk"].as<std::size_t>(), result["threads"].as<unsigned>());
+        });
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double, std::nano> total_time = end_time - start_time;
+
+    std::cout << total << " values x " << layers.size() << " layers" << std::endl;
+    std::cout << total_time.count() << " ns" << std::endl;
+
+    return 0;
+}
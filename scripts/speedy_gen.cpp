@@ -0,0 +1,187 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "cxxopts.hpp"
+#include "speedy/binary_format.hpp"
+#include "speedy/generate.hpp"
+#include "speedy/parallel.hpp"
+
+// Writes each chunk of values as CSV lines, formatted on every thread into its own buffer and
+// written in order, so memory stays at a few chunks whatever the dataset size.
+class CsvWriter {
+public:
+    explicit CsvWriter(const std::string& path) : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open " + path + " for writing");
+        }
+    }
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    ~CsvWriter() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    void append(const std::vector<uint64_t>& values, unsigned threads) {
+        std::size_t slices = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        buffers_.resize(slices);
+        std::size_t slice_size = (values.size() + slices - 1) / slices;
+        speedy::parallel_for(slices, threads, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t slice = begin; slice < end; ++slice) {
+                std::size_t first = std::min(values.size(), slice * slice_size);
+                std::size_t last = std::min(values.size(), first + slice_size);
+                std::string& buffer = buffers_[slice];
+                buffer.resize((last - first) * 21);
+                char* cursor = buffer.data();
+                for (std::size_t i = first; i < last; ++i) {
+                    cursor = std::to_chars(cursor, cursor + 20, values[i]).ptr;
+                    *cursor++ = '\n';
+                }
+                buffer.resize(cursor - buffer.data());
+            }
+        });
+        for (const std::string& buffer : buffers_) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size()) {
+                throw std::runtime_error("short write to " + path_);
+            }
+        }
+    }
+
+    void close() {
+        if (std::fclose(file_) != 0) {
+            file_ = nullptr;
+            throw std::runtime_error("cannot close " + path_);
+        }
+        file_ = nullptr;
+    }
+
+private:
+    std::string path_;
+    std::FILE* file_;
+    std::vector<std::string> buffers_;
+};
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("speedy-gen", "Generate test datasets of values from 1..n^k");
+
+    options.add_options()
+        ("n", "The base number n", cxxopts::value<int>())
+        ("k", "The exponent k", cxxopts::value<int>())
+        ("count", "Values to write (default n^k)", cxxopts::value<uint64_t>())
+        ("max-value", "Cap the value range at 1..max-value, e.g. 2147483647 for int readers",
+         cxxopts::value<uint64_t>())
+        ("distribution", "shuffled, sorted, reversed, zipf or duplicates",
+         cxxopts::value<std::string>()->default_value("shuffled"))
+        ("seed", "Seed for the keyed permutation and random draws", cxxopts::value<uint64_t>()->default_value("1"))
+        ("zipf", "Zipf exponent", cxxopts::value<double>()->default_value("1.1"))
+        ("distinct", "Distinct values for duplicates (default count / 8)",
+         cxxopts::value<uint64_t>()->default_value("0"))
+        ("format", "csv or bin", cxxopts::value<std::string>()->default_value("csv"))
+        ("out", "Output path", cxxopts::value<std::string>()->default_value("test_set.csv"))
+        ("threads", "Worker threads (0 = all cores)", cxxopts::value<unsigned>()->default_value("0"))
+        ("chunk", "Values generated per chunk", cxxopts::value<std::size_t>()->default_value("1048576"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    int n = result["n"].as<int>();
+    int k = result["k"].as<int>();
+    uint64_t domain = 1;
+    for (int i = 0; i < k; ++i) {
+        if (n < 1 || __builtin_mul_overflow(domain, static_cast<uint64_t>(n), &domain)) {
+            std::cerr << "n^k must be between 1 and 2^64 - 1" << std::endl;
+            return 1;
+        }
+    }
+
+    if (result.count("max-value")) {
+        domain = std::min(domain, std::max<uint64_t>(1, result["max-value"].as<uint64_t>()));
+    }
+
+    std::string format = result["format"].as<std::string>();
+    if (format != "csv" && format != "bin") {
+        std::cerr << "Unsupported format: " << format << " (expected csv or bin)" << std::endl;
+        return 1;
+    }
+
+    speedy::DatasetSpec spec;
+    spec.domain = domain;
+    spec.count = result.count("count") ? result["count"].as<uint64_t>() : domain;
+    spec.seed = result["seed"].as<uint64_t>();
+    spec.zipf_exponent = result["zipf"].as<double>();
+    spec.distinct = result["distinct"].as<uint64_t>();
+    unsigned threads = result["threads"].as<unsigned>();
+    // Chunks start on sample block boundaries so every value is independent of the chunking.
+    std::size_t chunk = std::max<std::size_t>(1, result["chunk"].as<std::size_t>() / speedy::kSampleBlock) *
+                        speedy::kSampleBlock;
+    std::string out = result["out"].as<std::string>();
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    try {
+        spec.distribution = speedy::parse_distribution(result["distribution"].as<std::string>());
+        speedy::DatasetGenerator generator(spec);
+
+        std::unique_ptr<CsvWriter> csv;
+        std::unique_ptr<speedy::LayerFileWriter> bin;
+        if (format == "csv") {
+            csv = std::make_unique<CsvWriter>(out);
+        } else {
+            // Raw values are layer 0 of the binary format.
+            bin = std::make_unique<speedy::LayerFileWriter>(out, speedy::word_bytes<uint64_t>(), 0);
+        }
+
+        std::vector<uint64_t> values;
+        std::vector<char> bytes;
+        for (uint64_t first = 0; first < spec.count; first += chunk) {
+            values.resize(static_cast<std::size_t>(std::min<uint64_t>(chunk, spec.count - first)));
+            generator.generate(first, values.size(), values.data(), threads);
+            if (csv) {
+                csv->append(values, threads);
+            } else {
+                bytes.clear();
+                speedy::append_words(values.data(), values.size(), bytes);
+                bin->append(bytes);
+            }
+        }
+
+        if (csv) {
+            csv->close();
+        } else {
+            bin->close();
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double, std::nano> total_time = end_time - start_time;
+
+    std::cout << "File saved with " << spec.count << " values in '" << out << "'" << std::endl;
+    std::cout << total_time.count() << " ns" << std::endl;
+
+    return 0;
+}
@@ -11,67 +11,38 @@
 
 #include <iostream>
 #include <vector>
-#include <cmath>
 #include <chrono>
 #include <fstream>
 #include <algorithm>
-#include <sstream>
+#include <memory>
+#include <thread>
 #include "cxxopts.hpp"
+#include "speedy/batch.hpp"
+#include "speedy/binary_format.hpp"
+#include "speedy/codec.hpp"
+#include "speedy/csv.hpp"
+#include "speedy/memory.hpp"
+#include "speedy/reference.hpp"
+#include "speedy/reduce.hpp"
+#include "speedy/report.hpp"
+#include "speedy/specialized.hpp"
+#include "speedy/timeline.hpp"
+#include "speedy/trace.hpp"
 
-double encode(double Y, int D) {
-    return pow(2, D) * (Y + D / 2.0);
-}
-
-double decode(double X, int D) {
-    return X / pow(2, D) - D / 2.0;
-}
-
-std::vector<int> ithPermutation(int n, int k, int i) {
-    std::vector<int> result;
-    int factor = 1;
-
-    for (int j = 1; j <= k; ++j) {
-        factor *= j;
-        int element = (i / factor) % (j + 1);
-        result.push_back(element);
-    }
+SPEEDY_COUNT_ALLOCATIONS()
 
-    return result;
-}
-
-std::vector<int> reverse_engineer_encoded_value(int value, int layer_depth, int n, int k, std::vector<double>& timings, std::vector<int>& sizes) {
+std::vector<int> reverse_engineer_encoded_value(int value, int layer_depth, int n, int k) {
     if (layer_depth == 0) {
-        return ithPermutation(n, k, value);
+        return speedy::ithPermutation(n, k, value);
     }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    double decoded_value = decode(value, 1);
-    int original_value = static_cast<int>(decoded_value - layer_depth / 2.0);
-    auto result = reverse_engineer_encoded_value(original_value, layer_depth - 1, n, k, timings, sizes);
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::nano> duration = end_time - start_time;
-
-    timings.push_back(duration.count());
-    sizes.push_back(sizeof(result));
-
-    return result;
-}
-
-std::vector<int> load_values_from_csv(const std::string& csv_file_path) {
-    std::vector<int> values;
-    std::ifstream file(csv_file_path);
-    std::string line;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        int value;
-        ss >> value;
-        values.push_back(value);
+    int original_value;
+    {
+        SPEEDY_TRACE_LAYER(layer_depth);
+        double decoded_value = speedy::decode(value, 1);
+        original_value = static_cast<int>(decoded_value - layer_depth / 2.0);
     }
-
-    return values;
+    return reverse_engineer_encoded_value(original_value, layer_depth - 1, n, k);
 }
 
 int main(int argc, char* argv[]) {
@@ -82,6 +53,17 @@ int main(int argc, char* argv[]) {
         ("n", "Total number of elements", cxxopts::value<int>())
         ("k", "Number of elements in the permutation", cxxopts::value<int>())
         ("csv", "Path to the CSV file", cxxopts::value<std::string>())
+        ("bin", "Path to a 64-bit layer file from speedy_encode, instead of --csv", cxxopts::value<std::string>())
+        ("verify", "Cross-check the composed layer transform against the layered walk")
+        ("batch-out", "Reverse every value and write the layer-0 indices to this path", cxxopts::value<std::string>())
+        ("threads", "Worker threads for parsing, reduction and batch reversal (0 = all cores)", cxxopts::value<unsigned>()->default_value("0"))
+        ("permutations", "Write the unranked permutation of each value instead of its index to --batch-out")
+        ("cache", "Entries in the memo cache for --permutations (0 = off)", cxxopts::value<std::size_t>()->default_value("0"))
+        ("trace", "Time every layer of the walk over all values and print per-layer latencies")
+        ("report", "Print a per-phase report in this format instead of the plain result (json)", cxxopts::value<std::string>())
+        ("perf-counters", "Add hardware counters for each phase to --report, where the kernel allows")
+        ("phase-rss", "Reset and sample the peak RSS around each phase of --report instead of once per run")
+        ("timeline", "Write a Chrome trace-event JSON of phases and per-thread work to this path", cxxopts::value<std::string>())
         ("help", "Print help");
 
     auto result = options.parse(argc, argv);
@@ -91,24 +73,215 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (result.count("report") && result["report"].as<std::string>() != "json") {
+        std::cerr << "--report supports json" << std::endl;
+        return 1;
+    }
+
     int n = result["n"].as<int>();
     int k = result["k"].as<int>();
-    std::string csv_file_path = result["csv"].as<std::string>();
+    unsigned threads = result["threads"].as<unsigned>();
+    if (result.count("timeline")) {
+        speedy::Timeline::instance().enable();
+    }
+    speedy::Report report(result.count("report") > 0);
+    if (result.count("phase-rss")) {
+        report.track_phase_rss();
+    }
+    std::unique_ptr<speedy::PerfCounters> counters;
+    if (report.enabled() && result.count("perf-counters")) {
+        counters = std::make_unique<speedy::PerfCounters>();
+        report.attach_counters(*counters);
+    }
+
+    std::vector<int> values;
+    if (result.count("bin")) {
+        std::string path = result["bin"].as<std::string>();
+        std::vector<uint64_t> words;
+        {
+            speedy::PhaseScope phase(report, "load");
+            words = speedy::load_words_from_binary(path);
+            phase.count(sizeof(speedy::BinaryHeader) + words.size() * sizeof(uint64_t), words.size());
+        }
+        speedy::PhaseScope phase(report, "parse");
+        values = speedy::values_from_words(words, path);
+        phase.count(words.size() * sizeof(uint64_t), values.size());
+    } else {
+        std::string text;
+        {
+            speedy::PhaseScope phase(report, "load");
+            text = speedy::read_file(result["csv"].as<std::string>());
+            phase.count(text.size(), 0);
+        }
+        speedy::PhaseScope phase(report, "parse");
+        values = speedy::parse_csv_values(text, threads);
+        phase.count(text.size(), values.size());
+    }
+    if (values.empty()) {
+        std::cerr << "no values to reduce" << std::endl;
+        return 1;
+    }
+    int l = speedy::layers_for(n, k);
+    speedy::ShapeDispatch dispatch(n, k, l);
+    const speedy::LayerPlan& plan = dispatch.plan();
 
-    std::vector<int> values = load_values_from_csv(csv_file_path);
-    int l = static_cast<int>(std::ceil(k * std::log2(n)));
-    std::vector<double> timings;
-    std::vector<int> sizes;
+    if (result.count("verify")) {
+        speedy::PhaseScope phase(report, "verify");
+        phase.count(values.size() * sizeof(int), values.size());
+        std::vector<int> dispatched(dispatch.width());
+        std::vector<int> batched(values.size());
+        speedy::reverse_batch(values.data(), values.size(), l, batched.data());
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            int value = values[i];
+            int walked = speedy::walk_layers(value, l);
+            if (plan.apply(value) != walked || batched[i] != walked) {
+                std::cerr << "verify failed for " << value << ": composed " << plan.apply(value)
+                          << ", batched " << batched[i] << ", layered " << walked << std::endl;
+                return 1;
+            }
+            dispatch.reverse(value, dispatched.data());
+            if (dispatched != speedy::ithPermutation(n, k, walked)) {
+                std::cerr << "verify failed for " << value << ": specialized chain disagrees" << std::endl;
+                return 1;
+            }
+        }
+        speedy::AllocationSnapshot before = speedy::allocation_snapshot();
+        for (int value : values) {
+            dispatch.reverse(value, dispatched.data());
+        }
+        if (speedy::allocation_snapshot().allocations != before.allocations) {
+            std::cerr << "verify failed: the reverse path allocated" << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!speedy::verify_unranking(n, k, 1 << 12, error)) {
+            std::cerr << "verify failed: " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "verified " << values.size() << " values over " << l << " layers" << std::endl;
+    }
 
+    std::vector<int> permutation(dispatch.width());
     auto start_time = std::chrono::high_resolution_clock::now();
-    auto smallest_value = *std::min_element(values.begin(), values.end());
-    reverse_engineer_encoded_value(smallest_value, l, n, k, timings, sizes);
+    int smallest_value;
+    {
+        speedy::PhaseScope phase(report, "reduce");
+        smallest_value = speedy::min_value(values.data(), values.size(), threads);
+        phase.count(values.size() * sizeof(int), values.size());
+    }
+    {
+        speedy::PhaseScope phase(report, "reverse");
+        dispatch.reverse(smallest_value, permutation.data());
+        phase.count(0, 1);
+    }
     auto end_time = std::chrono::high_resolution_clock::now();
 
+    if (result.count("verify")) {
+        if (reverse_engineer_encoded_value(smallest_value, l, n, k) != permutation) {
+            std::cerr << "verify failed: layered walk disagrees for " << smallest_value << std::endl;
+            return 1;
+        }
+    }
+
     std::chrono::duration<double, std::nano> total_time = end_time - start_time;
 
-    std::cout << smallest_value << std::endl;
-    std::cout << total_time.count() << " ns" << std::endl;
+    if (!report.enabled()) {
+        std::cout << smallest_value << std::endl;
+        std::cout << total_time.count() << " ns" << std::endl;
+    }
+
+    if (result.count("trace")) {
+        speedy::layer_tracer().enable();
+        for (int value : values) {
+            reverse_engineer_encoded_value(value, l, n, k);
+        }
+        speedy::layer_tracer().disable();
+        speedy::write_layer_latencies(std::cerr, speedy::layer_tracer().summary());
+    }
+
+    if (result.count("batch-out")) {
+        if (result.count("permutations") && k > n) {
+            std::cerr << "--permutations needs k <= n" << std::endl;
+            return 1;
+        }
+        std::size_t cache_entries = result["cache"].as<std::size_t>();
+        bool permutations = result.count("permutations") > 0;
+        std::size_t row_width = permutations ? k : 1;
+        std::vector<int> rows(values.size() * row_width);
+        std::unique_ptr<speedy::LayerCache> layer_cache;
+        std::unique_ptr<speedy::PermutationCache> permutation_cache;
+
+        auto batch_start = std::chrono::high_resolution_clock::now();
+        {
+            speedy::PhaseScope phase(report, "batch");
+            phase.count(values.size() * sizeof(int), values.size());
+            if (!permutations) {
+                speedy::reverse_batch(values.data(), values.size(), l, rows.data(), threads);
+            } else if (cache_entries == 0) {
+                speedy::reverse_batch_permutations(n, k, values.data(), values.size(), l, rows.data(), threads);
+            } else {
+                layer_cache = std::make_unique<speedy::LayerCache>(cache_entries);
+                permutation_cache = std::make_unique<speedy::PermutationCache>(cache_entries);
+                speedy::reverse_batch_permutations(n, k, values.data(), values.size(), l, rows.data(), *layer_cache,
+                                                   *permutation_cache, threads);
+            }
+        }
+        auto batch_end = std::chrono::high_resolution_clock::now();
+        report.set_kernel("batch", !permutations ? speedy::batch_kernel() : cache_entries == 0 ? "unrank" : "cached_unrank");
+
+        {
+            speedy::PhaseScope phase(report, "write");
+            std::ofstream batch_file(result["batch-out"].as<std::string>());
+            for (std::size_t i = 0; i < rows.size(); i += row_width) {
+                for (std::size_t j = 0; j < row_width; ++j) {
+                    batch_file << (j == 0 ? "" : ",") << rows[i + j];
+                }
+                batch_file << '\n';
+            }
+            phase.count(static_cast<uint64_t>(batch_file.tellp()), values.size());
+        }
+
+        std::chrono::duration<double, std::nano> batch_time = batch_end - batch_start;
+        std::cerr << "reversed " << values.size() << " values in " << batch_time.count() << " ns" << std::endl;
+        if (layer_cache) {
+            speedy::CacheStats layer_stats = layer_cache->stats();
+            speedy::CacheStats permutation_stats = permutation_cache->stats();
+            std::cerr << "layer cache: " << layer_stats.hits << " hits, " << layer_stats.misses << " misses, "
+                      << layer_stats.evictions << " evictions" << std::endl;
+            std::cerr << "permutation cache: " << permutation_stats.hits << " hits, " << permutation_stats.misses
+                      << " misses, " << permutation_stats.evictions << " evictions" << std::endl;
+            if (report.enabled()) {
+                report.set("layer_cache_hits", layer_stats.hits);
+                report.set("layer_cache_misses", layer_stats.misses);
+                report.set("layer_cache_evictions", layer_stats.evictions);
+                report.set("permutation_cache_hits", permutation_stats.hits);
+                report.set("permutation_cache_misses", permutation_stats.misses);
+                report.set("permutation_cache_evictions", permutation_stats.evictions);
+            }
+        }
+    }
+
+    if (report.enabled()) {
+        report.set("binary", "speedy_min");
+        report.set("n", n);
+        report.set("k", k);
+        report.set("layers", l);
+        report.set("threads", threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads);
+        report.set("value", smallest_value);
+        // The scopes' snapshots run inside start_time..end_time when reporting; their own wall
+        // times leave them out, so ns matches the plain run.
+        report.set("ns", report.phase_wall_ns("reduce") + report.phase_wall_ns("reverse"));
+        report.set("reduce_threads", speedy::parallel_chunks(values.size(), threads, speedy::kReduceMinChunk));
+        report.set_kernel("reduce", "speedy::min_value");
+        report.set_kernel("reverse", dispatch.specialized() ? "specialized" : "layer_plan");
+        report.set_kernel("select", speedy::selection_kernel(n));
+        report.write_json(std::cout);
+    }
+
+    if (result.count("timeline") && !speedy::Timeline::instance().write(result["timeline"].as<std::string>())) {
+        std::cerr << "cannot write " << result["timeline"].as<std::string>() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
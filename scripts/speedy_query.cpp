@@ -0,0 +1,131 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "cxxopts.hpp"
+#include "speedy/serve.hpp"
+
+void print_values(const std::vector<int32_t>& values) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        std::cout << (i == 0 ? "" : ",") << values[i];
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("speedy-query", "Query a running speedy_serve");
+
+    options.add_options()
+        ("socket", "Path of the Unix domain socket", cxxopts::value<std::string>()->default_value("/tmp/speedy.sock"))
+        ("dataset", "Dataset name or id", cxxopts::value<std::string>()->default_value("0"))
+        ("op", "list, min, max, rank, top-k or range", cxxopts::value<std::string>()->default_value("min"))
+        ("value", "Value for rank", cxxopts::value<int64_t>()->default_value("0"))
+        ("low", "Lower bound for range", cxxopts::value<int64_t>()->default_value("0"))
+        ("high", "Upper bound for range", cxxopts::value<int64_t>()->default_value("0"))
+        ("limit", "Values returned by top-k and range", cxxopts::value<uint32_t>()->default_value("10"))
+        ("largest", "top-k returns the largest values instead of the smallest")
+        ("repeat", "Send the query this many times and print latency percentiles", cxxopts::value<std::size_t>()->default_value("1"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    try {
+        speedy::ServeClient client(result["socket"].as<std::string>());
+        std::string op = result["op"].as<std::string>();
+
+        if (op == "list") {
+            std::vector<std::string> names = client.list();
+            for (std::size_t id = 0; id < names.size(); ++id) {
+                std::cout << id << " " << names[id] << std::endl;
+            }
+            return 0;
+        }
+
+        std::string name = result["dataset"].as<std::string>();
+        uint16_t dataset = 0;
+        if (!name.empty() && std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            dataset = static_cast<uint16_t>(std::stoul(name));
+        } else {
+            std::vector<std::string> names = client.list();
+            auto found = std::find(names.begin(), names.end(), name);
+            if (found == names.end()) {
+                std::cerr << "No dataset named " << name << std::endl;
+                return 1;
+            }
+            dataset = static_cast<uint16_t>(found - names.begin());
+        }
+
+        int64_t value = result["value"].as<int64_t>();
+        int64_t low = result["low"].as<int64_t>();
+        int64_t high = result["high"].as<int64_t>();
+        uint32_t limit = result["limit"].as<uint32_t>();
+        bool largest = result.count("largest") > 0;
+
+        // Runs the query once and prints its answer.
+        auto query = [&](bool print) {
+            std::vector<int32_t> values;
+            if (op == "min" || op == "max") {
+                int64_t extremum = op == "min" ? client.min(dataset, &values) : client.max(dataset, &values);
+                if (print) {
+                    std::cout << extremum << std::endl;
+                    print_values(values);
+                }
+            } else if (op == "rank") {
+                int64_t equal = 0;
+                int64_t below = client.rank(dataset, value, &equal);
+                if (print) {
+                    std::cout << below << " below, " << equal << " equal" << std::endl;
+                }
+            } else if (op == "top-k") {
+                values = client.top_k(dataset, limit, largest);
+                if (print) {
+                    print_values(values);
+                }
+            } else if (op == "range") {
+                int64_t count = client.range(dataset, low, high, limit, &values);
+                if (print) {
+                    std::cout << count << " in range" << std::endl;
+                    print_values(values);
+                }
+            } else {
+                throw std::runtime_error("Unsupported op: " + op + " (expected list, min, max, rank, top-k or range)");
+            }
+        };
+
+        query(true);
+
+        std::size_t repeat = result["repeat"].as<std::size_t>();
+        if (repeat > 1) {
+            std::vector<double> latencies(repeat);
+            for (double& latency : latencies) {
+                auto start_time = std::chrono::steady_clock::now();
+                query(false);
+                latency = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+            }
+            std::sort(latencies.begin(), latencies.end());
+            std::cerr << "Round trip over " << repeat << " queries: min " << latencies.front() << " ns, median "
+                      << latencies[repeat / 2] << " ns, p99 " << latencies[repeat * 99 / 100] << " ns" << std::endl;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,454 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "cxxopts.hpp"
+#include "speedy/library.hpp"
+#include "speedy/serve.hpp"
+
+// A dataset kept resident: the values as loaded, a sorted copy that answers rank, top-k and
+// range queries by binary search, and the extrema with their permutations worked out up front.
+struct Dataset {
+    std::string name;
+    std::vector<int> sorted;
+    std::vector<int32_t> min_permutation;
+    std::vector<int32_t> max_permutation;
+};
+
+// Per-client buffers. Requests are read in bulk and answered in order into out, which is sent
+// as the socket accepts it; both keep their capacity, so steady-state queries do not allocate.
+// Once the client shuts down its side, eof is set and the connection stays open only until the
+// responses already owed have been sent.
+struct Connection {
+    int fd;
+    std::vector<char> in;
+    std::size_t in_used = 0;
+    std::vector<char> out;
+    std::size_t out_sent = 0;
+    uint32_t events = 0;
+    bool eof = false;
+
+    std::size_t pending() const { return out.size() - out_sent; }
+};
+
+Dataset load_dataset(const std::string& spec, const speedy::lib::Solver& solver, unsigned threads) {
+    std::size_t equals = spec.find('=');
+    if (equals == std::string::npos || equals == 0) {
+        throw std::runtime_error("--dataset takes name=path, got " + spec);
+    }
+    Dataset dataset;
+    dataset.name = spec.substr(0, equals);
+    dataset.sorted = speedy::lib::load_values(spec.substr(equals + 1), threads);
+    std::sort(dataset.sorted.begin(), dataset.sorted.end());
+    if (!dataset.sorted.empty()) {
+        dataset.min_permutation.resize(solver.width());
+        dataset.max_permutation.resize(solver.width());
+        solver.reverse(dataset.sorted.front(), dataset.min_permutation.data());
+        solver.reverse(dataset.sorted.back(), dataset.max_permutation.data());
+    }
+    return dataset;
+}
+
+class Server {
+public:
+    Server(std::vector<Dataset> datasets, const std::string& socket_path)
+        : datasets_(std::move(datasets)), socket_path_(socket_path) {
+        for (const Dataset& dataset : datasets_) {
+            names_ += dataset.name;
+            names_ += '\n';
+        }
+        listen_on(socket_path);
+        watch_signals();
+    }
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    ~Server() {
+        for (auto& entry : connections_) {
+            ::close(entry.first);
+        }
+        ::close(listen_fd_);
+        ::close(signal_fd_);
+        ::close(epoll_fd_);
+        ::unlink(socket_path_.c_str());
+    }
+
+    uint64_t requests() const { return requests_; }
+
+    // Serves until SIGINT or SIGTERM.
+    void run() {
+        epoll_event events[64];
+        while (true) {
+            int ready = ::epoll_wait(epoll_fd_, events, 64, -1);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("epoll_wait: ") + std::strerror(errno));
+            }
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == signal_fd_) {
+                    return;
+                }
+                if (fd == listen_fd_) {
+                    accept_clients();
+                    continue;
+                }
+                auto found = connections_.find(fd);
+                if (found == connections_.end()) {
+                    continue;
+                }
+                Connection& connection = *found->second;
+                bool open = (events[i].events & EPOLLERR) == 0;
+                if (open && (events[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                    open = receive(connection);
+                }
+                // Sending can make room for requests that were held back, and answering those
+                // can fill the buffer again, so alternate until one of them stalls.
+                while (open) {
+                    open = flush(connection);
+                    if (!open || connection.pending() > 0 || !answer_buffered(connection)) {
+                        break;
+                    }
+                }
+                if (open && connection.eof && connection.pending() == 0) {
+                    open = false;
+                }
+                if (open) {
+                    update_events(connection);
+                } else {
+                    close_client(fd);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t kReadBlock = 1 << 16;
+    // Responses a client may have waiting before its requests stop being read, so one that
+    // pipelines large queries without reading the answers cannot grow the server without bound.
+    static constexpr std::size_t kMaxPendingBytes = 1 << 22;
+
+    void listen_on(const std::string& path) {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path too long: " + path);
+        }
+        // A socket left behind by a previous run is replaced; any other file is not.
+        struct stat existing;
+        if (::lstat(path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                throw std::runtime_error(path + " exists and is not a socket");
+            }
+            ::unlink(path.c_str());
+        }
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listen_fd_, 128) != 0) {
+            throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(errno));
+        }
+
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw std::runtime_error(std::string("epoll_create1: ") + std::strerror(errno));
+        }
+        watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    void watch_signals() {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        sigprocmask(SIG_BLOCK, &signals, nullptr);
+        signal_fd_ = ::signalfd(-1, &signals, SFD_CLOEXEC);
+        if (signal_fd_ < 0) {
+            throw std::runtime_error(std::string("signalfd: ") + std::strerror(errno));
+        }
+        watch(signal_fd_, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    void watch(int fd, uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, operation, fd, &event) != 0) {
+            throw std::runtime_error(std::string("epoll_ctl: ") + std::strerror(errno));
+        }
+    }
+
+    void accept_clients() {
+        while (true) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->in.resize(kReadBlock);
+            connection->events = EPOLLIN | EPOLLRDHUP;
+            watch(fd, connection->events, EPOLL_CTL_ADD);
+            connections_.emplace(fd, std::move(connection));
+        }
+    }
+
+    void close_client(int fd) {
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections_.erase(fd);
+    }
+
+    // Reads what the socket holds and answers every complete request, stopping early while too
+    // many responses are waiting to be sent. Sets eof when the client has shut down its side.
+    // Returns false once the connection has failed.
+    bool receive(Connection& connection) {
+        while (!connection.eof && connection.pending() < kMaxPendingBytes) {
+            if (connection.in.size() - connection.in_used < kReadBlock / 2) {
+                connection.in.resize(connection.in.size() * 2);
+            }
+            ssize_t read = ::recv(connection.fd, connection.in.data() + connection.in_used,
+                                  connection.in.size() - connection.in_used, 0);
+            if (read == 0) {
+                connection.eof = true;
+                break;
+            }
+            if (read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            connection.in_used += static_cast<std::size_t>(read);
+            answer_buffered(connection);
+        }
+        return true;
+    }
+
+    // Answers the complete requests already read, up to the pending-output limit. Returns
+    // whether any were answered.
+    bool answer_buffered(Connection& connection) {
+        std::size_t offset = 0;
+        for (; offset + sizeof(speedy::ServeRequest) <= connection.in_used && connection.pending() < kMaxPendingBytes;
+             offset += sizeof(speedy::ServeRequest)) {
+            speedy::ServeRequest request;
+            std::memcpy(&request, connection.in.data() + offset, sizeof(request));
+            answer(request, connection.out);
+            ++requests_;
+        }
+        std::memmove(connection.in.data(), connection.in.data() + offset, connection.in_used - offset);
+        connection.in_used -= offset;
+        return offset > 0;
+    }
+
+    // Sends pending responses as far as the socket allows. Returns false once the connection
+    // has failed.
+    bool flush(Connection& connection) {
+        while (connection.pending() > 0) {
+            ssize_t sent = ::send(connection.fd, connection.out.data() + connection.out_sent, connection.pending(),
+                                  MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return false;
+                }
+                break;
+            }
+            connection.out_sent += static_cast<std::size_t>(sent);
+        }
+        if (connection.pending() == 0) {
+            connection.out.clear();
+            connection.out_sent = 0;
+        }
+        return true;
+    }
+
+    // Watches for requests only while the client is sending and under the pending-output
+    // limit, and for writability only while responses are left over.
+    void update_events(Connection& connection) {
+        uint32_t events = 0;
+        if (!connection.eof && connection.pending() < kMaxPendingBytes) {
+            events |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (connection.pending() > 0) {
+            events |= EPOLLOUT;
+        }
+        if (events != connection.events) {
+            watch(connection.fd, events, EPOLL_CTL_MOD);
+            connection.events = events;
+        }
+    }
+
+    void answer(const speedy::ServeRequest& request, std::vector<char>& out) {
+        speedy::ServeResponse response{};
+        std::size_t header_at = out.size();
+        out.resize(header_at + sizeof(response));
+
+        auto append = [&](const void* data, std::size_t bytes) {
+            std::size_t at = out.size();
+            out.resize(at + bytes);
+            std::memcpy(out.data() + at, data, bytes);
+            response.payload_bytes += static_cast<uint32_t>(bytes);
+        };
+
+        if (request.op == speedy::ServeOp::list) {
+            append(names_.data(), names_.size());
+        } else if (request.dataset >= datasets_.size()) {
+            response.status = speedy::ServeStatus::unknown_dataset;
+        } else {
+            const std::vector<int>& sorted = datasets_[request.dataset].sorted;
+            auto lower = [&](int64_t value) {
+                return std::lower_bound(sorted.begin(), sorted.end(), value,
+                                        [](int element, int64_t bound) { return element < bound; });
+            };
+            auto upper = [&](int64_t value) {
+                return std::upper_bound(sorted.begin(), sorted.end(), value,
+                                        [](int64_t bound, int element) { return bound < element; });
+            };
+
+            switch (request.op) {
+                case speedy::ServeOp::min:
+                case speedy::ServeOp::max: {
+                    if (sorted.empty()) {
+                        response.status = speedy::ServeStatus::empty_dataset;
+                        break;
+                    }
+                    bool smallest = request.op == speedy::ServeOp::min;
+                    const auto& permutation = smallest ? datasets_[request.dataset].min_permutation
+                                                       : datasets_[request.dataset].max_permutation;
+                    response.value = smallest ? sorted.front() : sorted.back();
+                    append(permutation.data(), permutation.size() * sizeof(int32_t));
+                    break;
+                }
+                case speedy::ServeOp::rank: {
+                    auto first = lower(request.a);
+                    response.value = first - sorted.begin();
+                    response.extra = upper(request.a) - first;
+                    break;
+                }
+                case speedy::ServeOp::top_k: {
+                    std::size_t count = std::min<std::size_t>({request.limit, speedy::kServeMaxValues, sorted.size()});
+                    response.value = static_cast<int64_t>(count);
+                    if (request.flags & speedy::kServeLargest) {
+                        for (std::size_t i = 0; i < count; ++i) {
+                            int32_t value = sorted[sorted.size() - 1 - i];
+                            append(&value, sizeof(value));
+                        }
+                    } else {
+                        append(sorted.data(), count * sizeof(int32_t));
+                    }
+                    break;
+                }
+                case speedy::ServeOp::range: {
+                    if (request.a > request.b) {
+                        response.status = speedy::ServeStatus::bad_request;
+                        break;
+                    }
+                    auto first = lower(request.a);
+                    auto last = upper(request.b);
+                    response.value = last - first;
+                    std::size_t count = std::min<std::size_t>(
+                        {request.limit, speedy::kServeMaxValues, static_cast<std::size_t>(last - first)});
+                    append(sorted.data() + (first - sorted.begin()), count * sizeof(int32_t));
+                    break;
+                }
+                default:
+                    response.status = speedy::ServeStatus::bad_request;
+                    break;
+            }
+        }
+
+        std::memcpy(out.data() + header_at, &response, sizeof(response));
+    }
+
+    std::vector<Dataset> datasets_;
+    std::string socket_path_;
+    std::string names_;
+    int listen_fd_ = -1;
+    int signal_fd_ = -1;
+    int epoll_fd_ = -1;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    uint64_t requests_ = 0;
+};
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("speedy-serve", "Keep datasets resident and answer queries over a Unix domain socket");
+
+    options.add_options()
+        ("n", "Total number of elements", cxxopts::value<int>())
+        ("k", "Number of elements in the permutation", cxxopts::value<int>())
+        ("dataset", "name=path of a CSV or 64-bit layer file; repeat for more", cxxopts::value<std::vector<std::string>>())
+        ("socket", "Path of the Unix domain socket", cxxopts::value<std::string>()->default_value("/tmp/speedy.sock"))
+        ("threads", "Worker threads for loading (0 = all cores)", cxxopts::value<unsigned>()->default_value("0"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    if (!result.count("dataset")) {
+        std::cerr << "At least one --dataset is required" << std::endl;
+        return 1;
+    }
+
+    try {
+        speedy::lib::Solver solver(result["n"].as<int>(), result["k"].as<int>());
+        unsigned threads = result["threads"].as<unsigned>();
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::vector<Dataset> datasets;
+        for (const std::string& spec : result["dataset"].as<std::vector<std::string>>()) {
+            datasets.push_back(load_dataset(spec, solver, threads));
+            std::cerr << "Dataset " << datasets.size() - 1 << ": " << datasets.back().name << ", "
+                      << datasets.back().sorted.size() << " values" << std::endl;
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> load_time = end_time - start_time;
+        if (datasets.size() > UINT16_MAX + 1u) {
+            std::cerr << "At most " << UINT16_MAX + 1u << " datasets can be served" << std::endl;
+            return 1;
+        }
+
+        Server server(std::move(datasets), result["socket"].as<std::string>());
+        std::cerr << "Loaded in " << load_time.count() << " ns; serving on " << result["socket"].as<std::string>()
+                  << std::endl;
+        server.run();
+        std::cerr << "Served " << server.requests() << " requests" << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
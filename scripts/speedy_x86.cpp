@@ -9,98 +9,33 @@
 
 #include <iostream>
 #include <vector>
-#include <cmath>
 #include <chrono>
 #include <fstream>
 #include <algorithm>
-#include <sstream>
+#include <memory>
 #include "cxxopts.hpp"
+#include "speedy/codec.hpp"
+#include "speedy/csv.hpp"
+#include "speedy/memory.hpp"
+#include "speedy/permutation.hpp"
+#include "speedy/report.hpp"
+#include "speedy/timeline.hpp"
+#include "speedy/trace.hpp"
 
-double encode(double Y, int D) {
-    double result;
-    asm volatile(
-        "fldl2e\n\t"        // Load log2(e) to stack
-        "fmulp\n\t"         // Multiply ST(1) with ST(0), store result in ST(1)
-        "fild %1\n\t"       // Load int D
-        "faddp\n\t"         // Add ST(1) to ST(0)
-        "fyl2x\n\t"         // Compute ST(1) * log2(ST(0))
-        "fld1\n\t"          // Load constant 1
-        "fadd\n\t"          // Add ST(1) to ST(0)
-        "fscale\n\t"        // Scale by power of 2
-        "fstp %0"           // Store result in 'result'
-        : "=m"(result)
-        : "m"(D), "m"(Y)
-    );
-    return result;
-}
-
-double decode(double X, int D) {
-    double result;
-    asm volatile(
-        "fldl2e\n\t"        // Load log2(e) to stack
-        "fild %1\n\t"       // Load int D
-        "fmulp\n\t"         // Multiply ST(1) with ST(0), store result in ST(1)
-        "fyl2x\n\t"         // Compute ST(1) * log2(ST(0))
-        "fld1\n\t"          // Load constant 1
-        "fadd\n\t"          // Add ST(1) to ST(0)
-        "fscale\n\t"        // Scale by power of 2
-        "fld %2\n\t"        // Load double X
-        "fdivp\n\t"         // Divide X by the result in ST(0)
-        "fild %1\n\t"       // Load int D
-        "fsubp\n\t"         // Subtract D/2 from the result
-        "fstp %0"           // Store result in 'result'
-        : "=m"(result)
-        : "m"(D), "m"(X)
-    );
-    return result;
-}
+SPEEDY_COUNT_ALLOCATIONS()
 
-std::vector<int> ithPermutation(int n, int k, int i) {
-    std::vector<int> result;
-    int factor = 1;
-
-    for (int j = 1; j <= k; ++j) {
-        factor *= j;
-        int element = (i / factor) % (j + 1);
-        result.push_back(element);
-    }
-
-    return result;
-}
-
-std::vector<int> reverse_engineer_encoded_value(int value, int layer_depth, int n, int k, std::vector<double>& timings, std::vector<int>& sizes) {
+std::vector<int> reverse_engineer_encoded_value(int value, int layer_depth, int n, int k) {
     if (layer_depth == 0) {
-        return ithPermutation(n, k, value);
+        return speedy::ithPermutation(n, k, value);
     }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    double decoded_value = decode(value, 1);
-    int original_value = static_cast<int>(decoded_value - layer_depth / 2.0);
-    auto result = reverse_engineer_encoded_value(original_value, layer_depth - 1, n, k, timings, sizes);
-
-    auto end_time = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::nano> duration = end_time - start_time;
-
-    timings.push_back(duration.count());
-    sizes.push_back(sizeof(result));
-
-    return result;
-}
-
-std::vector<int> load_values_from_csv(const std::string& csv_file_path) {
-    std::vector<int> values;
-    std::ifstream file(csv_file_path);
-    std::string line;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        int value;
-        ss >> value;
-        values.push_back(value);
+    int original_value;
+    {
+        SPEEDY_TRACE_LAYER(layer_depth);
+        double decoded_value = speedy::decode_x87(value, 1);
+        original_value = static_cast<int>(decoded_value - layer_depth / 2.0);
     }
-
-    return values;
+    return reverse_engineer_encoded_value(original_value, layer_depth - 1, n, k);
 }
 
 int main(int argc, char* argv[]) {
@@ -113,6 +48,11 @@ int main(int argc, char* argv[]) {
         ("n", "Total number of elements", cxxopts::value<int>())
         ("k", "Number of elements in the permutation", cxxopts::value<int>())
         ("csv", "Path to the CSV file", cxxopts::value<std::string>())
+        ("trace", "Time every layer of the walk over all values and print per-layer latencies")
+        ("report", "Print a per-phase report in this format instead of the plain result (json)", cxxopts::value<std::string>())
+        ("perf-counters", "Add hardware counters for each phase to --report, where the kernel allows")
+        ("phase-rss", "Reset and sample the peak RSS around each phase of --report instead of once per run")
+        ("timeline", "Write a Chrome trace-event JSON of phases and per-thread work to this path", cxxopts::value<std::string>())
         ("help", "Print help");
 
     auto result = options.parse(argc, argv);
@@ -122,24 +62,93 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (result.count("report") && result["report"].as<std::string>() != "json") {
+        std::cerr << "--report supports json" << std::endl;
+        return 1;
+    }
+
     n = result["n"].as<int>();
     k = result["k"].as<int>();
     csv_file_path = result["csv"].as<std::string>();
+    if (result.count("timeline")) {
+        speedy::Timeline::instance().enable();
+    }
+    speedy::Report report(result.count("report") > 0);
+    if (result.count("phase-rss")) {
+        report.track_phase_rss();
+    }
+    std::unique_ptr<speedy::PerfCounters> counters;
+    if (report.enabled() && result.count("perf-counters")) {
+        counters = std::make_unique<speedy::PerfCounters>();
+        report.attach_counters(*counters);
+    }
 
-    std::vector<int> values = load_values_from_csv(csv_file_path);
-    int l = static_cast<int>(std::ceil(k * std::log2(n)));
-    std::vector<double> timings;
-    std::vector<int> sizes;
+    std::string text;
+    {
+        speedy::PhaseScope phase(report, "load");
+        text = speedy::read_file(csv_file_path);
+        phase.count(text.size(), 0);
+    }
+    std::vector<int> values;
+    {
+        speedy::PhaseScope phase(report, "parse");
+        values = speedy::parse_csv_values(text);
+        phase.count(text.size(), values.size());
+    }
+    if (values.empty()) {
+        std::cerr << "no values to reduce" << std::endl;
+        return 1;
+    }
+    int l = speedy::layers_for(n, k);
 
     auto start_time = std::chrono::high_resolution_clock::now();
-    auto smallest_value = *std::min_element(values.begin(), values.end());
-    reverse_engineer_encoded_value(smallest_value, l, n, k, timings, sizes);
+    int smallest_value;
+    {
+        speedy::PhaseScope phase(report, "reduce");
+        smallest_value = *std::min_element(values.begin(), values.end());
+        phase.count(values.size() * sizeof(int), values.size());
+    }
+    {
+        speedy::PhaseScope phase(report, "reverse");
+        reverse_engineer_encoded_value(smallest_value, l, n, k);
+        phase.count(0, 1);
+    }
     auto end_time = std::chrono::high_resolution_clock::now();
 
     std::chrono::duration<double, std::nano> total_time = end_time - start_time;
 
-    std::cout << smallest_value << std::endl;
-    std::cout << total_time.count() << " ns" << std::endl;
+    if (report.enabled()) {
+        report.set("binary", "speedy_x86");
+        report.set("n", n);
+        report.set("k", k);
+        report.set("layers", l);
+        report.set("threads", 1);
+        report.set("value", smallest_value);
+        // The scopes' snapshots run inside start_time..end_time when reporting; their own wall
+        // times leave them out, so ns matches the plain run.
+        report.set("ns", report.phase_wall_ns("reduce") + report.phase_wall_ns("reverse"));
+        report.set_kernel("reduce", "std::min_element");
+        report.set_kernel("reverse", "x87");
+        report.set_kernel("select", speedy::selection_kernel(n));
+        report.write_json(std::cout);
+    } else {
+        std::cout << smallest_value << std::endl;
+        std::cout << total_time.count() << " ns" << std::endl;
+    }
+
+    if (result.count("trace")) {
+        speedy::layer_tracer().enable();
+        for (int value : values) {
+            reverse_engineer_encoded_value(value, l, n, k);
+        }
+        speedy::layer_tracer().disable();
+        speedy::write_layer_latencies(std::cerr, speedy::layer_tracer().summary());
+    }
+
+    if (result.count("timeline") && !speedy::Timeline::instance().write(result["timeline"].as<std::string>())) {
+        std::cerr << "cannot write " << result["timeline"].as<std::string>() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
@@ -0,0 +1,97 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "speedy/library.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "speedy/batch.hpp"
+#include "speedy/binary_format.hpp"
+#include "speedy/csv.hpp"
+#include "speedy/permutation.hpp"
+#include "speedy/reduce.hpp"
+#include "speedy/specialized.hpp"
+#include "speedy/tables.hpp"
+
+namespace speedy {
+namespace lib {
+
+namespace {
+
+bool is_layer_file(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    char magic[sizeof(kBinaryMagic)] = {};
+    bool matches = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                   std::memcmp(magic, kBinaryMagic, sizeof(magic)) == 0;
+    std::fclose(file);
+    return matches;
+}
+
+void require_values(const std::vector<int>& values) {
+    if (values.empty()) {
+        throw std::runtime_error("no values to reduce");
+    }
+}
+
+}  // namespace
+
+std::vector<int> load_values(const std::string& path, unsigned threads) {
+    if (is_layer_file(path)) {
+        return load_values_from_binary(path);
+    }
+    return parse_csv_values(read_file(path), threads);
+}
+
+int min_value(const std::vector<int>& values, unsigned threads) {
+    require_values(values);
+    return speedy::min_value(values.data(), values.size(), threads);
+}
+
+int max_value(const std::vector<int>& values, unsigned threads) {
+    require_values(values);
+    return speedy::max_value(values.data(), values.size(), threads);
+}
+
+struct Solver::Impl {
+    Impl(int n, int k) : n(n), k(k), layers(layers_for(n, k)), dispatch(n, k, layers) {}
+
+    int n;
+    int k;
+    int layers;
+    ShapeDispatch dispatch;
+};
+
+Solver::Solver(int n, int k) : impl_(std::make_unique<Impl>(n, k)) {}
+Solver::~Solver() = default;
+Solver::Solver(Solver&&) noexcept = default;
+Solver& Solver::operator=(Solver&&) noexcept = default;
+
+int Solver::n() const { return impl_->n; }
+int Solver::k() const { return impl_->k; }
+int Solver::layers() const { return impl_->layers; }
+int Solver::width() const { return impl_->dispatch.width(); }
+
+int64_t Solver::reverse_index(int value) const { return impl_->dispatch.plan().apply(value); }
+
+void Solver::reverse(int value, int* permutation) const { impl_->dispatch.reverse(value, permutation); }
+
+void Solver::reverse_indices(const int* values, std::size_t count, int* indices, unsigned threads) const {
+    reverse_batch(values, count, impl_->layers, indices, threads);
+}
+
+bool unrank(int n, int k, uint64_t rank, int* permutation) { return unrank_permutation(n, k, rank, permutation); }
+
+bool rank(int n, int k, const int* permutation, uint64_t& rank) { return rank_permutation(n, k, permutation, rank); }
+
+}  // namespace lib
+}  // namespace speedy
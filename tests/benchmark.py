@@ -1,29 +1,274 @@
-import pandas as pd
+import argparse
+import csv
+import json
+import os
+import random
+import statistics
+import subprocess
+import sys
 import time
 
-def find_min_value_in_single_column_csv(file_path):
-    # Load the CSV file
-    df = pd.read_csv(file_path)
-    
-    # Start the high-resolution timer
+# End-to-end benchmark of the speedy tools over a grid of (n, k) datasets.
+#
+# Every implementation is run as a separate process against the same dataset, with warmup
+# runs that are discarded and timed repetitions that are kept. Reports the median wall time
+# with a bootstrap confidence interval, the tool's own timing where it reports one, and the
+# speedup of each implementation over a baseline.
+#
+# python3 benchmark.py --bin-dir ../build --grid 2:16 10:6 100:5 --repetitions 15 --json results.json
+
+INT_MAX = 2**31 - 1
+IMPLEMENTATIONS = ['speedy_min', 'speedy_max', 'speedy_x86', 'speedy.py']
+SCRIPTS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'scripts')
+
+
+def parse_shape(text):
+    n, k = text.split(':')
+    return int(n), int(k)
+
+
+def dataset_path(data_dir, n, k, count):
+    return os.path.join(data_dir, f'n{n}_k{k}_{count}.csv')
+
+
+def generate_dataset(path, n, k, count, seed, bin_dir):
+    # Distinct values from 1..min(n^k, INT_MAX) in random order: the whole range shuffled when
+    # it fits in count, a uniform sample otherwise. The C++ tools read values as int. Written
+    # to a temporary file first so an interrupted run never leaves a truncated dataset cached.
+    tmp_path = path + '.tmp'
+    generator = os.path.join(bin_dir, 'speedy_gen')
+    if os.path.exists(generator):
+        subprocess.run([generator, '-n', str(n), '-k', str(k), '--count', str(count), '--max-value', str(INT_MAX),
+                        '--seed', str(seed), '--out', tmp_path], check=True, stdout=subprocess.DEVNULL)
+    else:
+        rng = random.Random(seed)
+        upper = min(n**k, INT_MAX)
+        values = rng.sample(range(1, upper + 1), count)
+        with open(tmp_path, 'w') as handle:
+            handle.write('\n'.join(map(str, values)))
+            handle.write('\n')
+    os.replace(tmp_path, path)
+
+
+def prepare_dataset(args, n, k):
+    count = min(n**k, INT_MAX, args.max_values)
+    path = dataset_path(args.data_dir, n, k, count)
+    if not os.path.exists(path):
+        print(f'Generating {count} values for n={n}, k={k} in {path}', file=sys.stderr)
+        generate_dataset(path, n, k, count, args.seed, args.bin_dir)
+    return path, count
+
+
+def command_for(args, implementation, n, k, path, count):
+    if implementation == 'speedy.py':
+        # speedy.py has no CSV input; it generates and shuffles all n^k values itself.
+        if n**k > args.py_max_values:
+            return None
+        return [sys.executable, os.path.join(SCRIPTS_DIR, 'speedy.py'), '-n', str(n), '-k', str(k), '-p', 'T']
+
+    binary = os.path.join(args.bin_dir, implementation)
+    if not os.path.exists(binary):
+        return None
+    command = [binary, '-n', str(n), '-k', str(k), '--csv', path, '--report', 'json']
+    if args.threads is not None and implementation != 'speedy_x86':
+        command += ['--threads', str(args.threads)]
+    return command
+
+
+def set_cache_state(path, mode):
+    if mode == 'warm':
+        with open(path, 'rb') as handle:
+            while handle.read(1 << 20):
+                pass
+    elif mode == 'cold':
+        # Evicts the dataset's clean pages; drop_caches additionally clears everything else
+        # but needs root.
+        with open(path, 'rb') as handle:
+            os.posix_fadvise(handle.fileno(), 0, 0, os.POSIX_FADV_DONTNEED)
+        try:
+            os.sync()
+            with open('/proc/sys/vm/drop_caches', 'w') as handle:
+                handle.write('3\n')
+        except OSError:
+            pass
+
+
+def run_once(command, path, args):
+    if path is not None:
+        set_cache_state(path, args.cache)
+
+    def pin():
+        if args.cpus:
+            os.sched_setaffinity(0, args.cpus)
+
     start_time = time.perf_counter_ns()
-    
-    # Find the minimum value in the first (and only) column
-    min_value = df.iloc[:, 0].min()
-    
-    # Find the index of the minimum value
-    min_index = df[df.iloc[:, 0] == min_value].index[0]
-    
-    # End the timer
-    end_time = time.perf_counter_ns()
-    duration_ns = end_time - start_time
-
-    return min_index, min_value, duration_ns
+    completed = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, preexec_fn=pin)
+    wall_ns = time.perf_counter_ns() - start_time
+    if completed.returncode != 0:
+        raise RuntimeError(f'{" ".join(command)} exited with {completed.returncode}: {completed.stderr.strip()}')
+
+    tool_ns = None
+    value = None
+    if '--report' in command:
+        report = json.loads(completed.stdout)
+        # The tool's own time for the reduction and reverse path. Summing those phases matches
+        # the report's ns and also holds for older builds, whose ns included the report's own
+        # bookkeeping.
+        timed = [phase['wall_ns'] for phase in report.get('phases', []) if phase['name'] in ('reduce', 'reverse')]
+        tool_ns = sum(timed) if timed else report['ns']
+        value = report['value']
+    else:
+        for line in completed.stdout.splitlines():
+            if line.startswith('The smallest value at depth 0 is:'):
+                value = line.split(':')[1].strip()
+    return wall_ns, tool_ns, value
+
+
+def bootstrap_median_ci(samples, confidence, resamples, rng):
+    medians = sorted(statistics.median(rng.choices(samples, k=len(samples))) for _ in range(resamples))
+    tail = (1 - confidence) / 2
+    return medians[int(tail * (resamples - 1))], medians[int((1 - tail) * (resamples - 1))]
+
+
+def bootstrap_ratio_ci(numerator, denominator, confidence, resamples, rng):
+    ratios = sorted(
+        statistics.median(rng.choices(numerator, k=len(numerator)))
+        / statistics.median(rng.choices(denominator, k=len(denominator)))
+        for _ in range(resamples))
+    tail = (1 - confidence) / 2
+    return ratios[int(tail * (resamples - 1))], ratios[int((1 - tail) * (resamples - 1))]
+
+
+def benchmark(args):
+    os.makedirs(args.data_dir, exist_ok=True)
+    rng = random.Random(args.seed)
+    rows = []
+
+    for n, k in args.grid:
+        path, count = prepare_dataset(args, n, k)
+        samples = {}
+        for implementation in args.implementations:
+            command = command_for(args, implementation, n, k, path, count)
+            if command is None:
+                print(f'Skipping {implementation} for n={n}, k={k}', file=sys.stderr)
+                continue
+            input_path = None if implementation == 'speedy.py' else path
+            for _ in range(args.warmups):
+                run_once(command, input_path, args)
+            wall = []
+            tool = []
+            value = None
+            for _ in range(args.repetitions):
+                wall_ns, tool_ns, value = run_once(command, input_path, args)
+                wall.append(wall_ns)
+                if tool_ns is not None:
+                    tool.append(tool_ns)
+            samples[implementation] = wall
+
+            low, high = bootstrap_median_ci(wall, args.confidence, args.resamples, rng)
+            rows.append({
+                'n': n,
+                'k': k,
+                'values': n**k if implementation == 'speedy.py' else count,
+                'implementation': implementation,
+                'result': value,
+                'repetitions': len(wall),
+                'median_ns': statistics.median(wall),
+                'ci_low_ns': low,
+                'ci_high_ns': high,
+                'min_ns': min(wall),
+                'tool_median_ns': statistics.median(tool) if tool else None,
+                'samples_ns': wall,
+            })
+
+        baseline = samples.get(args.baseline)
+        for row in rows:
+            if (row['n'], row['k']) != (n, k):
+                continue
+            if baseline is None:
+                row['speedup'] = row['speedup_ci_low'] = row['speedup_ci_high'] = None
+                continue
+            own = samples[row['implementation']]
+            row['speedup'] = statistics.median(baseline) / row['median_ns']
+            row['speedup_ci_low'], row['speedup_ci_high'] = bootstrap_ratio_ci(
+                baseline, own, args.confidence, args.resamples, rng)
+
+    return rows
+
+
+def print_table(rows, baseline):
+    print(f'{"n":>5} {"k":>3} {"implementation":<12} {"median ms":>11} {"CI":>23} {"tool ms":>10} '
+          f'{"vs " + baseline:>16}')
+    for row in rows:
+        ci = f'[{row["ci_low_ns"] / 1e6:.3f}, {row["ci_high_ns"] / 1e6:.3f}]'
+        tool = '-' if row['tool_median_ns'] is None else f'{row["tool_median_ns"] / 1e6:.3f}'
+        speedup = '-' if row['speedup'] is None else f'{row["speedup"]:.2f}x'
+        print(f'{row["n"]:>5} {row["k"]:>3} {row["implementation"]:<12} {row["median_ns"] / 1e6:>11.3f} {ci:>23} '
+              f'{tool:>10} {speedup:>16}')
+
+
+def save_csv(rows, path):
+    fields = ['n', 'k', 'values', 'implementation', 'result', 'repetitions', 'median_ns', 'ci_low_ns', 'ci_high_ns',
+              'min_ns', 'tool_median_ns', 'speedup', 'speedup_ci_low', 'speedup_ci_high']
+    with open(path, 'w', newline='') as csvfile:
+        writer = csv.DictWriter(csvfile, fieldnames=fields, extrasaction='ignore')
+        writer.writeheader()
+        writer.writerows(rows)
+
+
+def save_json(rows, args, path):
+    document = {
+        'config': {
+            'warmups': args.warmups,
+            'repetitions': args.repetitions,
+            'confidence': args.confidence,
+            'cache': args.cache,
+            'cpus': sorted(args.cpus) if args.cpus else None,
+            'threads': args.threads,
+            'baseline': args.baseline,
+            'max_values': args.max_values,
+        },
+        'results': rows,
+    }
+    with open(path, 'w') as handle:
+        json.dump(document, handle, indent=2)
+        handle.write('\n')
+
+
+def main(args):
+    rows = benchmark(args)
+    print_table(rows, args.baseline)
+    if args.csv:
+        save_csv(rows, args.csv)
+    if args.json:
+        save_json(rows, args, args.json)
+
 
 if __name__ == "__main__":
-    # Replace with your actual file path
-    file_path = 'original_permutations.csv'
-    
-    min_index, min_value, duration_ns = find_min_value_in_single_column_csv(file_path)
-    print(f"The smallest value is {min_value} at index {min_index}.")
-    print(f"Time taken: {duration_ns} nanoseconds.")
\ No newline at end of file
+    parser = argparse.ArgumentParser(description='Benchmark the speedy tools end to end over a grid of (n, k).')
+    parser.add_argument('--grid', type=parse_shape, nargs='+', default=[(2, 16), (10, 6), (26, 5), (100, 5)],
+                        help='(n, k) pairs as n:k.')
+    parser.add_argument('--implementations', nargs='+', choices=IMPLEMENTATIONS, default=IMPLEMENTATIONS,
+                        help='Implementations to run.')
+    parser.add_argument('--bin-dir', default='build', help='Directory holding the compiled tools.')
+    parser.add_argument('--data-dir', default='bench_data', help='Where generated datasets are cached.')
+    parser.add_argument('--max-values', type=int, default=1 << 22, help='Cap on values per dataset.')
+    parser.add_argument('--py-max-values', type=int, default=1 << 16,
+                        help='Largest n^k speedy.py is run for; it holds every value in a Python list.')
+    parser.add_argument('--warmups', type=int, default=2, help='Discarded runs before timing.')
+    parser.add_argument('--repetitions', type=int, default=10, help='Timed runs per implementation.')
+    parser.add_argument('--cpus', type=lambda text: {int(cpu) for cpu in text.split(',')}, default=None,
+                        help='Pin every run to these CPUs, e.g. 2,3.')
+    parser.add_argument('--threads', type=int, default=None, help='Passed as --threads to speedy_min and speedy_max.')
+    parser.add_argument('--cache', choices=['cold', 'warm', 'none'], default='warm',
+                        help='Evict the dataset from the page cache or read it in before each run.')
+    parser.add_argument('--baseline', choices=IMPLEMENTATIONS, default='speedy_min',
+                        help='Implementation speedups are relative to.')
+    parser.add_argument('--confidence', type=float, default=0.95, help='Confidence level of the intervals.')
+    parser.add_argument('--resamples', type=int, default=2000, help='Bootstrap resamples per interval.')
+    parser.add_argument('--seed', type=int, default=1, help='Seed for datasets and bootstrap resampling.')
+    parser.add_argument('--csv', help='Write results to this CSV file.')
+    parser.add_argument('--json', help='Write results and configuration to this JSON file.')
+
+    args = parser.parse_args()
+    main(args)
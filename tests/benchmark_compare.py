@@ -0,0 +1,312 @@
+import argparse
+import csv
+import datetime
+import functools
+import io
+import json
+import math
+import os
+import platform
+import random
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# Performance regression gate for the speedy tools.
+#
+# `record` runs the benchmark suites and stores every sample, with a fingerprint of the machine
+# and build, in a baseline file. `compare` reruns the suites (or loads a recorded run with
+# --current) and tests each benchmark against its baseline. A benchmark regresses when it is
+# slower by more than --threshold and the difference is significant at --alpha, by a one-sided
+# Mann-Whitney U test or a bootstrap interval on the ratio of medians. Any regression makes the
+# exit status 1.
+#
+# python3 benchmark_compare.py record --bin-dir ../build --baseline baseline.json
+# python3 benchmark_compare.py compare --bin-dir ../build --baseline baseline.json
+
+TESTS_DIR = os.path.dirname(os.path.abspath(__file__))
+FINGERPRINT_KEYS = ['cpu', 'cpu_flags', 'logical_cpus', 'machine', 'kernel', 'memory_kb', 'compiler', 'build_type']
+
+
+def read_first(path, prefix):
+    try:
+        with open(path) as handle:
+            for line in handle:
+                if line.startswith(prefix):
+                    return line.split(':', 1)[1].strip()
+    except OSError:
+        pass
+    return None
+
+
+def cmake_cache_value(bin_dir, key):
+    try:
+        with open(os.path.join(bin_dir, 'CMakeCache.txt')) as handle:
+            for line in handle:
+                if line.startswith(key + ':'):
+                    return line.split('=', 1)[1].strip()
+    except OSError:
+        pass
+    return None
+
+
+def machine_fingerprint(bin_dir):
+    flags = (read_first('/proc/cpuinfo', 'flags') or '').split()
+    memory = read_first('/proc/meminfo', 'MemTotal')
+    compiler = cmake_cache_value(bin_dir, 'CMAKE_CXX_COMPILER')
+    if compiler:
+        try:
+            version = subprocess.run([compiler, '--version'], stdout=subprocess.PIPE, text=True, check=True)
+            compiler = version.stdout.splitlines()[0]
+        except (OSError, subprocess.CalledProcessError):
+            pass
+    return {
+        'cpu': read_first('/proc/cpuinfo', 'model name') or platform.processor(),
+        'cpu_flags': [flag for flag in ['sse4_2', 'avx2', 'bmi2', 'avx512f'] if flag in flags],
+        'logical_cpus': os.cpu_count(),
+        'machine': platform.machine(),
+        'kernel': platform.release(),
+        'memory_kb': int(memory.split()[0]) if memory else None,
+        'compiler': compiler,
+        'build_type': cmake_cache_value(bin_dir, 'CMAKE_BUILD_TYPE'),
+    }
+
+
+def git_commit():
+    try:
+        completed = subprocess.run(['git', 'rev-parse', 'HEAD'], cwd=TESTS_DIR, stdout=subprocess.PIPE,
+                                   stderr=subprocess.DEVNULL, text=True, check=True)
+        return completed.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def run_micro(args):
+    command = [os.path.join(args.bin_dir, 'benchmark_micro'), '--csv', '--repetitions', str(args.repetitions),
+               '--min-time', str(args.min_time), '--max-bytes', str(args.max_bytes), '--filter', args.filter]
+    completed = subprocess.run(command, stdout=subprocess.PIPE, text=True, check=True)
+    benchmarks = {}
+    for row in csv.DictReader(io.StringIO(completed.stdout)):
+        samples = [float(sample) for sample in row['samples_ns_per_item'].split(';')]
+        benchmarks['micro/' + row['name']] = {'unit': 'ns/item', 'samples': samples}
+    return benchmarks
+
+
+def run_e2e(args):
+    benchmarks = {}
+    with tempfile.TemporaryDirectory() as scratch:
+        output = os.path.join(scratch, 'results.json')
+        command = [sys.executable, os.path.join(TESTS_DIR, 'benchmark.py'), '--bin-dir', args.bin_dir,
+                   '--data-dir', args.data_dir, '--repetitions', str(args.repetitions), '--json', output,
+                   '--grid'] + args.grid + ['--implementations'] + args.implementations
+        subprocess.run(command, stdout=subprocess.DEVNULL, check=True)
+        with open(output) as handle:
+            results = json.load(handle)['results']
+    for row in results:
+        name = f'e2e/{row["implementation"]}/n:{row["n"]}/k:{row["k"]}'
+        if args.filter in name:
+            benchmarks[name] = {'unit': 'ns', 'samples': row['samples_ns']}
+    return benchmarks
+
+
+def run_suites(args):
+    benchmarks = {}
+    if 'micro' in args.suite:
+        benchmarks.update(run_micro(args))
+    if 'e2e' in args.suite:
+        benchmarks.update(run_e2e(args))
+    return {
+        'version': 1,
+        'recorded': datetime.datetime.now(datetime.timezone.utc).isoformat(timespec='seconds'),
+        'commit': git_commit(),
+        'fingerprint': machine_fingerprint(args.bin_dir),
+        'config': {'suite': args.suite, 'repetitions': args.repetitions, 'min_time': args.min_time,
+                   'max_bytes': args.max_bytes, 'grid': args.grid},
+        'benchmarks': benchmarks,
+    }
+
+
+@functools.lru_cache(maxsize=None)
+def rank_sum_ways(m, n, u):
+    # Orderings of m current and n baseline samples, all distinct, in which exactly u
+    # (current, baseline) pairs have the current sample larger.
+    if u < 0 or u > m * n:
+        return 0
+    if m == 0 or n == 0:
+        return 1 if u == 0 else 0
+    return rank_sum_ways(m - 1, n, u - n) + rank_sum_ways(m, n - 1, u)
+
+
+def mann_whitney_greater(current, baseline):
+    # One-sided p-value that current tends to be larger than baseline. Exact for small samples
+    # without ties, normal approximation with tie and continuity corrections otherwise.
+    m = len(current)
+    n = len(baseline)
+    u = sum(1.0 if x > y else 0.5 if x == y else 0.0 for x in current for y in baseline)
+    ties = len(set(current) & set(baseline)) > 0 or len(set(current)) < m or len(set(baseline)) < n
+
+    if not ties and m <= 20 and n <= 20:
+        total = math.comb(m + n, m)
+        return sum(rank_sum_ways(m, n, value) for value in range(int(u), m * n + 1)) / total
+
+    combined = sorted(current + baseline)
+    tie_term = 0
+    index = 0
+    while index < len(combined):
+        run = 1
+        while index + run < len(combined) and combined[index + run] == combined[index]:
+            run += 1
+        tie_term += run**3 - run
+        index += run
+    count = m + n
+    variance = m * n / 12 * ((count + 1) - tie_term / (count * (count - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - m * n / 2 - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def bootstrap_ratio(current, baseline, confidence, resamples, rng):
+    ratios = sorted(
+        statistics.median(rng.choices(current, k=len(current)))
+        / statistics.median(rng.choices(baseline, k=len(baseline)))
+        for _ in range(resamples))
+    tail = (1 - confidence) / 2
+    return ratios[int(tail * (resamples - 1))], ratios[int((1 - tail) * (resamples - 1))]
+
+
+def compare_runs(baseline, current, args):
+    rng = random.Random(args.seed)
+    rows = []
+    for name in sorted(set(baseline['benchmarks']) | set(current['benchmarks'])):
+        if name not in current['benchmarks']:
+            rows.append({'name': name, 'status': 'missing'})
+            continue
+        if name not in baseline['benchmarks']:
+            rows.append({'name': name, 'status': 'new'})
+            continue
+        old = baseline['benchmarks'][name]['samples']
+        new = current['benchmarks'][name]['samples']
+        ratio = statistics.median(new) / statistics.median(old)
+        low, high = bootstrap_ratio(new, old, 1 - 2 * args.alpha, args.resamples, rng)
+
+        if args.test == 'mannwhitney':
+            slower = mann_whitney_greater(new, old) < args.alpha
+            faster = mann_whitney_greater(old, new) < args.alpha
+        else:
+            slower = low > 1
+            faster = high < 1
+
+        if slower and ratio > 1 + args.threshold:
+            status = 'regression'
+        elif faster and ratio < 1 - args.threshold:
+            status = 'improvement'
+        else:
+            status = 'ok'
+        rows.append({
+            'name': name,
+            'status': status,
+            'unit': current['benchmarks'][name]['unit'],
+            'baseline_median': statistics.median(old),
+            'current_median': statistics.median(new),
+            'ratio': ratio,
+            'ratio_ci_low': low,
+            'ratio_ci_high': high,
+            'p_slower': mann_whitney_greater(new, old),
+        })
+    return rows
+
+
+def fingerprint_differences(baseline, current):
+    return [key for key in FINGERPRINT_KEYS if baseline['fingerprint'].get(key) != current['fingerprint'].get(key)]
+
+
+def print_rows(rows):
+    print(f'{"benchmark":<48} {"baseline":>12} {"current":>12} {"ratio":>7} {"CI":>17} {"p":>8}  status')
+    for row in rows:
+        if 'ratio' not in row:
+            print(f'{row["name"]:<48} {"":>12} {"":>12} {"":>7} {"":>17} {"":>8}  {row["status"]}')
+            continue
+        ci = f'[{row["ratio_ci_low"]:.3f}, {row["ratio_ci_high"]:.3f}]'
+        print(f'{row["name"]:<48} {row["baseline_median"]:>12.4g} {row["current_median"]:>12.4g} '
+              f'{row["ratio"]:>7.3f} {ci:>17} {row["p_slower"]:>8.4f}  {row["status"]}')
+
+
+def load(path):
+    with open(path) as handle:
+        return json.load(handle)
+
+
+def save(document, path):
+    with open(path, 'w') as handle:
+        json.dump(document, handle, indent=2)
+        handle.write('\n')
+
+
+def record(args):
+    run = run_suites(args)
+    save(run, args.baseline)
+    print(f'Recorded {len(run["benchmarks"])} benchmarks in {args.baseline}', file=sys.stderr)
+    return 0
+
+
+def compare(args):
+    baseline = load(args.baseline)
+    current = load(args.current) if args.current else run_suites(args)
+    if args.save_current:
+        save(current, args.save_current)
+
+    differences = fingerprint_differences(baseline, current)
+    if differences:
+        print(f'Warning: baseline was recorded on a different machine or build ({", ".join(differences)})',
+              file=sys.stderr)
+        if args.require_same_machine:
+            return 2
+
+    rows = compare_runs(baseline, current, args)
+    print_rows(rows)
+    if args.json:
+        save({'baseline_commit': baseline.get('commit'), 'current_commit': current.get('commit'),
+              'fingerprint_differences': differences, 'results': rows}, args.json)
+
+    regressions = [row['name'] for row in rows if row['status'] == 'regression']
+    if regressions:
+        print(f'{len(regressions)} regression(s): {", ".join(regressions)}', file=sys.stderr)
+        return 1
+    return 0
+
+
+def main(args):
+    return record(args) if args.command == 'record' else compare(args)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Record benchmark baselines and flag significant regressions.')
+    parser.add_argument('command', choices=['record', 'compare'], help='Record a baseline or compare against one.')
+    parser.add_argument('--baseline', default='benchmark_baseline.json', help='Baseline file.')
+    parser.add_argument('--current', help='Compare this recorded run instead of rerunning the suites.')
+    parser.add_argument('--save-current', help='Also save the new run to this file.')
+    parser.add_argument('--bin-dir', default='build', help='Directory holding the compiled tools and benchmarks.')
+    parser.add_argument('--suite', nargs='+', choices=['micro', 'e2e'], default=['micro'], help='Suites to run.')
+    parser.add_argument('--filter', default='', help='Only benchmarks whose name contains this.')
+    parser.add_argument('--repetitions', type=int, default=10, help='Samples per benchmark.')
+    parser.add_argument('--min-time', type=float, default=0.05, help='Seconds per microbenchmark sample.')
+    parser.add_argument('--max-bytes', type=int, default=32 << 20, help='Largest microbenchmark working set.')
+    parser.add_argument('--grid', nargs='+', default=['10:6', '100:5'], help='(n, k) pairs for the e2e suite.')
+    parser.add_argument('--implementations', nargs='+', default=['speedy_min', 'speedy_max'],
+                        help='Implementations for the e2e suite.')
+    parser.add_argument('--data-dir', default='bench_data', help='Dataset cache for the e2e suite.')
+    parser.add_argument('--test', choices=['mannwhitney', 'bootstrap'], default='mannwhitney',
+                        help='Significance test.')
+    parser.add_argument('--alpha', type=float, default=0.01, help='Significance level.')
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='Smallest relative slowdown that counts as a regression.')
+    parser.add_argument('--resamples', type=int, default=2000, help='Bootstrap resamples.')
+    parser.add_argument('--seed', type=int, default=1, help='Seed for bootstrap resampling.')
+    parser.add_argument('--require-same-machine', action='store_true',
+                        help='Exit 2 instead of warning when the fingerprints differ.')
+    parser.add_argument('--json', help='Write the comparison to this JSON file.')
+
+    args = parser.parse_args()
+    sys.exit(main(args))
@@ -0,0 +1,443 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Microbenchmarks for the engine's kernels: the floating-point and x87 transforms, the layer
+// walk at several depths, unranking, CSV parsing and the min/max reduction over working sets
+// from L1-resident to DRAM-sized. Each case runs until it has taken --min-time seconds, the
+// best of --repetitions runs is kept, and throughput is reported per item and per byte. CSV
+// output also lists every run, for tests/benchmark_compare.py. --scaling instead measures how
+// parsing, reduction and the whole pipeline scale with threads.
+//
+// g++ -std=c++17 -O2 -pthread -I../include -o benchmark_micro benchmark_micro.cpp
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cxxopts.hpp"
+#include "speedy/batch.hpp"
+#include "speedy/codec.hpp"
+#include "speedy/csv.hpp"
+#include "speedy/enumerate.hpp"
+#include "speedy/layers.hpp"
+#include "speedy/parallel.hpp"
+#include "speedy/permutation.hpp"
+#include "speedy/reduce.hpp"
+
+// Keeps value alive and opaque to the optimizer.
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Case {
+    std::string name;
+    std::size_t items;
+    std::size_t bytes;
+    std::function<void()> run;
+};
+
+struct Measurement {
+    double ns_per_call;
+    std::size_t calls;
+    std::vector<double> samples;
+};
+
+Measurement measure(const Case& bench, double min_seconds, int repetitions) {
+    std::size_t calls = 1;
+    std::vector<double> samples;
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+        while (true) {
+            auto start_time = std::chrono::steady_clock::now();
+            for (std::size_t call = 0; call < calls; ++call) {
+                bench.run();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+            if (elapsed.count() >= min_seconds) {
+                samples.push_back(elapsed.count() * 1e9 / calls);
+                break;
+            }
+            calls = elapsed.count() <= 0 ? calls * 10
+                                         : std::max(calls * 2, static_cast<std::size_t>(calls * 1.2 * min_seconds /
+                                                                                         elapsed.count()));
+        }
+    }
+    return {*std::min_element(samples.begin(), samples.end()), calls, samples};
+}
+
+std::vector<int> random_values(std::size_t count, int low, int high, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> dist(low, high);
+    std::vector<int> values(count);
+    for (int& value : values) {
+        value = dist(rng);
+    }
+    return values;
+}
+
+std::string csv_text(const std::vector<int>& values) {
+    std::string text;
+    for (int value : values) {
+        text += std::to_string(value);
+        text += '\n';
+    }
+    return text;
+}
+
+std::string size_label(std::size_t bytes) {
+    if (bytes >= (1 << 20)) {
+        return std::to_string(bytes >> 20) + "MiB";
+    }
+    return std::to_string(bytes >> 10) + "KiB";
+}
+
+struct ScalingPoint {
+    std::string mode;
+    std::string kernel;
+    unsigned threads;
+    std::size_t active;
+    std::size_t bytes;
+    double seconds;
+};
+
+// Strong scaling (fixed total size) and weak scaling (fixed size per thread) of parsing, the
+// min reduction and the parse-reduce-reverse pipeline, next to a plain streaming read that
+// measures what the host's memory can deliver at each thread count.
+int run_scaling(const cxxopts::ParseResult& result) {
+    double min_seconds = result["min-time"].as<double>();
+    int repetitions = result["repetitions"].as<int>();
+    bool csv = result.count("csv") > 0;
+    unsigned max_threads = result["max-threads"].as<unsigned>();
+    if (max_threads == 0) {
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t strong_bytes = result["strong-bytes"].as<std::size_t>();
+    std::size_t weak_bytes = result["weak-bytes"].as<std::size_t>();
+
+    // The reduction only splits into chunks of kReduceMinChunk values, so a smaller strong
+    // working set would leave the higher thread counts idle.
+    std::size_t strong_floor = max_threads * speedy::kReduceMinChunk * sizeof(int);
+    if (strong_bytes < strong_floor) {
+        std::cerr << "Raising --strong-bytes to " << strong_floor << " so the reduction can use " << max_threads
+                  << " threads" << std::endl;
+        strong_bytes = strong_floor;
+    }
+
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    constexpr int kPipelineDepth = 20;
+    std::vector<ScalingPoint> points;
+    for (const char* mode : {"strong", "weak"}) {
+        for (unsigned threads : thread_counts) {
+            std::size_t bytes = std::string(mode) == "strong" ? strong_bytes : weak_bytes * threads;
+            auto values = std::make_shared<std::vector<int>>(random_values(bytes / sizeof(int), 1, 1 << 30, bytes));
+            auto text = std::make_shared<std::string>(csv_text(*values));
+            std::size_t value_bytes = values->size() * sizeof(int);
+
+            std::vector<Case> cases = {
+                {"stream", values->size(), value_bytes,
+                 [values, threads] {
+                     std::atomic<uint64_t> total{0};
+                     speedy::parallel_for(values->size(), threads, 1 << 16, [&](std::size_t begin, std::size_t end) {
+                         uint64_t sum = 0;
+                         for (std::size_t i = begin; i < end; ++i) {
+                             sum += static_cast<uint32_t>((*values)[i]);
+                         }
+                         total += sum;
+                     });
+                     keep(total.load());
+                 }},
+                {"parse", values->size(), text->size(),
+                 [text, threads] { keep(speedy::parse_csv_values(*text, threads).data()); }},
+                {"reduce", values->size(), value_bytes,
+                 [values, threads] { keep(speedy::min_value(values->data(), values->size(), threads)); }},
+                {"pipeline", values->size(), text->size(),
+                 [text, threads] {
+                     std::vector<int> parsed = speedy::parse_csv_values(*text, threads);
+                     keep(speedy::min_value(parsed.data(), parsed.size(), threads));
+                     std::vector<int> indices(parsed.size());
+                     speedy::reverse_batch(parsed.data(), parsed.size(), kPipelineDepth, indices.data(), threads);
+                     keep(indices.data());
+                 }},
+            };
+            // Threads each kernel actually runs on; fewer than asked when the input is too small to
+            // split that many ways.
+            std::size_t stream_active = speedy::parallel_chunks(values->size(), threads, 1 << 16);
+            std::size_t parse_active =
+                std::max<std::size_t>(1, std::min<std::size_t>(threads, text->size() / speedy::kParseMinChunkBytes));
+            std::size_t reduce_active = speedy::parallel_chunks(values->size(), threads, speedy::kReduceMinChunk);
+            std::size_t batch_active = speedy::parallel_chunks(values->size(), threads, speedy::kBatchMinChunk);
+            std::size_t active[] = {stream_active, parse_active, reduce_active,
+                                    std::max({parse_active, reduce_active, batch_active})};
+            for (std::size_t i = 0; i < cases.size(); ++i) {
+                Measurement measurement = measure(cases[i], min_seconds, repetitions);
+                points.push_back(
+                    {mode, cases[i].name, threads, active[i], cases[i].bytes, measurement.ns_per_call / 1e9});
+            }
+        }
+    }
+
+    // Speedup and efficiency against the same kernel on one thread. Strong scaling ideally
+    // divides the time by the thread count; weak scaling ideally keeps it flat. Efficiency is
+    // per thread that actually ran, which the active column shows.
+    auto single = [&](const ScalingPoint& point) {
+        for (const ScalingPoint& other : points) {
+            if (other.mode == point.mode && other.kernel == point.kernel && other.threads == 1) {
+                return other;
+            }
+        }
+        return point;
+    };
+
+    if (csv) {
+        std::cout << "mode,kernel,threads,active,bytes,seconds,gb_per_s,speedup,efficiency" << std::endl;
+    } else {
+        std::cout << "mode    kernel    threads  active        ms      GB/s  speedup  efficiency" << std::endl;
+    }
+    for (const ScalingPoint& point : points) {
+        const ScalingPoint base = single(point);
+        double gb_per_s = point.bytes / point.seconds / 1e9;
+        double speedup = point.mode == "strong" ? base.seconds / point.seconds
+                                                : base.seconds / point.seconds * point.threads;
+        double efficiency = speedup / point.active;
+        if (csv) {
+            std::cout << point.mode << "," << point.kernel << "," << point.threads << "," << point.active << ","
+                      << point.bytes << "," << point.seconds << "," << gb_per_s << "," << speedup << "," << efficiency
+                      << std::endl;
+        } else {
+            std::printf("%-7s %-9s %7u %7zu %9.3f %9.3f %8.2f %11.2f\n", point.mode.c_str(), point.kernel.c_str(),
+                        point.threads, point.active, point.seconds * 1e3, gb_per_s, speedup, efficiency);
+        }
+    }
+
+    // Bandwidth saturation: the fewest threads whose streaming read gets within 90% of the best
+    // any thread count reached. Past it, memory-bound kernels stop gaining from more threads.
+    double peak = 0;
+    for (const ScalingPoint& point : points) {
+        if (point.mode == "strong" && point.kernel == "stream") {
+            peak = std::max(peak, point.bytes / point.seconds / 1e9);
+        }
+    }
+    for (const ScalingPoint& point : points) {
+        if (point.mode == "strong" && point.kernel == "stream" && point.bytes / point.seconds / 1e9 >= 0.9 * peak) {
+            std::cerr << "Memory bandwidth saturates at " << point.threads << " thread(s), " << peak
+                      << " GB/s peak streaming read" << std::endl;
+            break;
+        }
+    }
+    for (const char* kernel : {"parse", "reduce", "pipeline"}) {
+        const ScalingPoint* best = nullptr;
+        for (const ScalingPoint& point : points) {
+            if (point.mode == "strong" && point.kernel == kernel && (best == nullptr || point.seconds < best->seconds)) {
+                best = &point;
+            }
+        }
+        if (best != nullptr && peak > 0) {
+            std::cerr << kernel << " is fastest at " << best->threads << " thread(s), "
+                      << 100.0 * (best->bytes / best->seconds / 1e9) / peak << "% of peak streaming bandwidth"
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("benchmark_micro", "Kernel microbenchmarks");
+
+    options.add_options()
+        ("filter", "Only run cases whose name contains this", cxxopts::value<std::string>()->default_value(""))
+        ("min-time", "Seconds each measurement runs for", cxxopts::value<double>()->default_value("0.2"))
+        ("repetitions", "Measurements per case; the fastest is reported", cxxopts::value<int>()->default_value("3"))
+        ("max-bytes", "Largest working set for parse and reduction cases", cxxopts::value<std::size_t>()->default_value("268435456"))
+        ("csv", "Print CSV instead of a table")
+        ("scaling", "Run the thread scaling benchmark instead of the kernel cases")
+        ("max-threads", "Largest thread count for --scaling (0 = all cores)",
+         cxxopts::value<unsigned>()->default_value("0"))
+        ("strong-bytes", "Total working set for strong scaling", cxxopts::value<std::size_t>()->default_value("67108864"))
+        ("weak-bytes", "Working set per thread for weak scaling", cxxopts::value<std::size_t>()->default_value("16777216"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    // Both modes keep the fastest of the repetitions, so there must be at least one.
+    if (result["repetitions"].as<int>() < 1) {
+        std::cerr << "--repetitions must be at least 1" << std::endl;
+        return 1;
+    }
+
+    if (result.count("scaling")) {
+        return run_scaling(result);
+    }
+
+    std::string filter = result["filter"].as<std::string>();
+    double min_seconds = result["min-time"].as<double>();
+    int repetitions = result["repetitions"].as<int>();
+    std::size_t max_bytes = result["max-bytes"].as<std::size_t>();
+
+    std::vector<Case> cases;
+    auto wanted = [&](const std::string& name) { return name.find(filter) != std::string::npos; };
+    auto add = [&](std::string name, std::size_t items, std::size_t bytes, std::function<void()> run) {
+        if (wanted(name)) {
+            cases.push_back({std::move(name), items, bytes, std::move(run)});
+        }
+    };
+
+    // Transforms: one call per value over a small L1-resident batch.
+    constexpr std::size_t kBatch = 1024;
+    auto inputs = std::make_shared<std::vector<int>>(random_values(kBatch, 1, 1 << 30, 1));
+    add("codec/encode", kBatch, 0, [inputs] {
+        for (int value : *inputs) {
+            keep(speedy::encode(value, 1));
+        }
+    });
+    add("codec/decode", kBatch, 0, [inputs] {
+        for (int value : *inputs) {
+            keep(speedy::decode(value, 1));
+        }
+    });
+#ifdef SPEEDY_HAVE_X87
+    add("codec/encode_x87", kBatch, 0, [inputs] {
+        for (int value : *inputs) {
+            keep(speedy::encode_x87(value, 1));
+        }
+    });
+    add("codec/decode_x87", kBatch, 0, [inputs] {
+        for (int value : *inputs) {
+            keep(speedy::decode_x87(value, 1));
+        }
+    });
+#endif
+
+    // The layer walk: reference, composed plan and the batch lanes, by depth.
+    for (int depth : {4, 16, 34, 64}) {
+        std::string suffix = "/depth:" + std::to_string(depth);
+        add("layers/walk" + suffix, kBatch, 0, [inputs, depth] {
+            for (int value : *inputs) {
+                keep(speedy::walk_layers(value, depth));
+            }
+        });
+        auto plan = std::make_shared<speedy::LayerPlan>(depth);
+        add("layers/plan" + suffix, kBatch, 0, [inputs, plan] {
+            for (int value : *inputs) {
+                keep(plan->apply(value));
+            }
+        });
+        auto out = std::make_shared<std::vector<int>>(kBatch);
+        add("layers/batch_scalar" + suffix, kBatch, kBatch * sizeof(int), [inputs, out, depth] {
+            speedy::detail::reverse_chunk_scalar(inputs->data(), kBatch, depth, out->data());
+            keep(out->data());
+        });
+        add("layers/batch_" + std::string(speedy::batch_kernel()) + suffix, kBatch, kBatch * sizeof(int),
+            [inputs, out, depth] {
+                speedy::detail::reverse_chunk(inputs->data(), kBatch, depth, out->data());
+                keep(out->data());
+            });
+    }
+
+    // Unranking, ranking and enumeration across selection paths.
+    for (auto shape : {std::pair{10, 6}, {64, 8}, {100, 5}, {1000, 10}}) {
+        int n = shape.first;
+        int k = shape.second;
+        std::string suffix = "/n:" + std::to_string(n) + "/k:" + std::to_string(k);
+        auto ranks = std::make_shared<std::vector<int>>(random_values(kBatch, 0, 1 << 30, 2));
+        auto row = std::make_shared<std::vector<int>>(k);
+        add("permutation/ith" + suffix, kBatch, 0, [ranks, row, n, k] {
+            for (int rank : *ranks) {
+                speedy::ithPermutation(n, k, rank, row->data());
+                keep(row->data());
+            }
+        });
+        auto rows = std::make_shared<std::vector<int>>(kBatch * k);
+        for (std::size_t i = 0; i < kBatch; ++i) {
+            speedy::ithPermutation(n, k, (*ranks)[i], rows->data() + i * k);
+        }
+        add("permutation/rank" + suffix, kBatch, 0, [rows, n, k] {
+            uint64_t rank = 0;
+            for (std::size_t i = 0; i < kBatch; ++i) {
+                speedy::rank_permutation(n, k, rows->data() + i * k, rank);
+                keep(rank);
+            }
+        });
+        add("permutation/cursor" + suffix, kBatch, 0, [n, k] {
+            speedy::for_each_permutation(n, k, 0, kBatch, [](const int* permutation, uint64_t) { keep(permutation); });
+        });
+    }
+
+    // Parsing and reduction over working sets from L1 to DRAM.
+    for (std::size_t bytes = 32 << 10; bytes <= max_bytes; bytes *= 32) {
+        std::size_t count = bytes / sizeof(int);
+        auto values = std::make_shared<std::vector<int>>(random_values(count, -1000000000, 1000000000, bytes));
+        std::string suffix = "/" + size_label(bytes);
+        if (wanted("csv/parse" + suffix) || wanted("csv/parse_threads" + suffix)) {
+            auto text = std::make_shared<std::string>(csv_text(*values));
+            add("csv/parse" + suffix, count, text->size(), [text] { keep(speedy::parse_csv_values(*text).data()); });
+            add("csv/parse_threads" + suffix, count, text->size(),
+                [text] { keep(speedy::parse_csv_values(*text, 0).data()); });
+        }
+        add("reduce/min_element" + suffix, count, bytes,
+            [values] { keep(*std::min_element(values->begin(), values->end())); });
+        add("reduce/max_element" + suffix, count, bytes,
+            [values] { keep(*std::max_element(values->begin(), values->end())); });
+        add("reduce/min_loop" + suffix, count, bytes, [values] {
+            int best = (*values)[0];
+            for (int value : *values) {
+                best = std::min(best, value);
+            }
+            keep(best);
+        });
+        add("reduce/min_value_threads" + suffix, count, bytes,
+            [values] { keep(speedy::min_value(values->data(), values->size(), 0)); });
+    }
+
+    bool csv = result.count("csv") > 0;
+    if (csv) {
+        std::cout << "name,items,calls,ns_per_call,ns_per_item,items_per_s,gb_per_s,samples_ns_per_item" << std::endl;
+    }
+    for (const Case& bench : cases) {
+        Measurement measurement = measure(bench, min_seconds, repetitions);
+        double seconds = measurement.ns_per_call / 1e9;
+        double ns_per_item = measurement.ns_per_call / bench.items;
+        double items_per_s = bench.items / seconds;
+        double gb_per_s = bench.bytes / seconds / 1e9;
+        if (csv) {
+            std::cout << bench.name << "," << bench.items << "," << measurement.calls << "," << measurement.ns_per_call
+                      << "," << ns_per_item << "," << items_per_s << "," << gb_per_s << ",";
+            for (std::size_t i = 0; i < measurement.samples.size(); ++i) {
+                std::cout << (i == 0 ? "" : ";") << measurement.samples[i] / bench.items;
+            }
+            std::cout << std::endl;
+        } else {
+            std::cout << bench.name << std::string(bench.name.size() < 44 ? 44 - bench.name.size() : 1, ' ')
+                      << ns_per_item << " ns/item  " << items_per_s / 1e6 << " M items/s";
+            if (bench.bytes > 0) {
+                std::cout << "  " << gb_per_s << " GB/s";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Compares the layered walk, the composed LayerPlan and the compile-time specialized chain
+// for every (n, k) in SPEEDY_SPECIALIZED_SHAPES.
+//
+// g++ -std=c++17 -O2 -pthread -I../include -o benchmark_specialized benchmark_specialized.cpp
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "cxxopts.hpp"
+#include "speedy/specialized.hpp"
+
+template <typename Fn>
+double time_per_value(const std::vector<int>& values, int k, long long& checksum, Fn&& reverse) {
+    std::vector<int> permutation(k);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int value : values) {
+        reverse(value, permutation.data());
+        checksum += permutation[k - 1];
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> total_time = end_time - start_time;
+    return total_time.count() / values.size();
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("benchmark_specialized", "Specialized layer chain benchmark");
+
+    options.add_options()
+        ("count", "Values reversed per shape", cxxopts::value<int>()->default_value("1000000"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    int count = result["count"].as<int>();
+    std::mt19937 rng(42);
+
+    std::cout << "n,k,layers,layered_ns,composed_ns,specialized_ns,vs_layered,vs_composed" << std::endl;
+    for (const auto& kernel : speedy::specialized_shapes()) {
+        // Read the shape through a volatile so the generic paths cannot constant-fold it.
+        volatile int runtime_n = kernel.n;
+        volatile int runtime_k = kernel.k;
+        int n = runtime_n;
+        int k = runtime_k;
+        int l = kernel.layer_depth;
+
+        std::uniform_int_distribution<int> dist(1, 1 << 30);
+        std::vector<int> values(count);
+        for (int& value : values) {
+            value = dist(rng);
+        }
+
+        long long layered_sum = 0;
+        long long composed_sum = 0;
+        long long specialized_sum = 0;
+
+        double layered = time_per_value(values, k, layered_sum, [&](int value, int* out) {
+            speedy::ithPermutation(n, k, speedy::walk_layers(value, l), out);
+        });
+
+        speedy::LayerPlan plan(l);
+        double composed = time_per_value(values, k, composed_sum, [&](int value, int* out) {
+            speedy::ithPermutation(n, k, static_cast<int>(plan.apply(value)), out);
+        });
+
+        const speedy::ShapeKernel* selected = speedy::find_specialized(n, k, l);
+        double specialized = time_per_value(values, k, specialized_sum, [&](int value, int* out) {
+            selected->reverse(value, out);
+        });
+
+        if (layered_sum != composed_sum || layered_sum != specialized_sum) {
+            std::cerr << "checksum mismatch for n=" << n << " k=" << k << std::endl;
+            return 1;
+        }
+
+        std::cout << n << "," << k << "," << l << "," << layered << "," << composed << ","
+                  << specialized << "," << layered / specialized << "," << composed / specialized << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// PGO training driver for libspeedy. The tools and benchmarks use the header-only engine
+// directly, so this is what exercises the library's own translation units: loading, the
+// threaded reductions, the Solver reverse path and (un)ranking, all through library.hpp.
+//
+// pgo_train -n 10 -k 6 --csv training.csv
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cxxopts.hpp"
+#include "speedy/library.hpp"
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("pgo_train", "Exercise libspeedy for profile-guided optimization");
+
+    options.add_options()
+        ("n", "Total number of elements", cxxopts::value<int>())
+        ("k", "Number of elements in the permutation", cxxopts::value<int>())
+        ("csv", "CSV or layer file to load", cxxopts::value<std::string>())
+        ("rounds", "Passes over the loaded values", cxxopts::value<int>()->default_value("3"))
+        ("help", "Print help");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help") || !result.count("n") || !result.count("k") || !result.count("csv")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : 1;
+    }
+
+    int n = result["n"].as<int>();
+    int k = result["k"].as<int>();
+    int rounds = result["rounds"].as<int>();
+
+    std::vector<int> values = speedy::lib::load_values(result["csv"].as<std::string>());
+    if (values.empty()) {
+        std::cerr << "no values to train on" << std::endl;
+        return 1;
+    }
+
+    speedy::lib::Solver solver(n, k);
+    std::vector<int> permutation(solver.width());
+    std::vector<int> indices(values.size());
+    long long checksum = 0;
+    for (int round = 0; round < rounds; ++round) {
+        checksum += speedy::lib::min_value(values, round == 0 ? 1 : 0);
+        checksum += speedy::lib::max_value(values, round == 0 ? 1 : 0);
+        solver.reverse_indices(values.data(), values.size(), indices.data(), round == 0 ? 1 : 0);
+        checksum += indices.back();
+        for (int value : values) {
+            checksum += solver.reverse_index(value);
+            if (solver.width() > 0) {
+                solver.reverse(value, permutation.data());
+                checksum += permutation[0];
+            }
+        }
+    }
+
+    if (k <= n) {
+        std::vector<int> unranked(k);
+        for (int value : values) {
+            uint64_t ranked = 0;
+            speedy::lib::unrank(n, k, static_cast<uint64_t>(value), unranked.data());
+            speedy::lib::rank(n, k, unranked.data(), ranked);
+            checksum += static_cast<long long>(ranked);
+        }
+    }
+
+    std::cout << checksum << std::endl;
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Copyright 2024 Chelsea Anne McElveen
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Checks the unranking engine against brute force over a grid of small shapes, and that the
+// keyed permutations behind speedy_gen are bijections. Run through ctest; exits non-zero on the
+// first disagreement.
+//
+// g++ -std=c++17 -O2 -pthread -I../include -o test_reference test_reference.cpp
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include "speedy/batch.hpp"
+#include "speedy/exact.hpp"
+#include "speedy/generate.hpp"
+#include "speedy/reference.hpp"
+
+namespace {
+
+bool check_unranking() {
+    std::vector<std::pair<int, int>> shapes;
+    for (int n = 1; n <= 8; ++n) {
+        for (int k = 1; k <= n; ++k) {
+            shapes.emplace_back(n, k);
+        }
+    }
+    // k == n beyond the exhaustive range, and n past one 64-bit selection mask.
+    for (auto shape : {std::make_pair(10, 10), std::make_pair(20, 20), std::make_pair(64, 3), std::make_pair(64, 64),
+                       std::make_pair(65, 2), std::make_pair(65, 65), std::make_pair(100, 5), std::make_pair(130, 7),
+                       std::make_pair(200, 200)}) {
+        shapes.push_back(shape);
+    }
+
+    bool ok = true;
+    for (auto [n, k] : shapes) {
+        std::string error;
+        if (!speedy::verify_unranking(n, k, 1 << 10, error)) {
+            std::cerr << "unranking: " << error << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool check_keyed_permutation() {
+    std::vector<uint64_t> domains;
+    for (uint64_t domain = 1; domain <= 300; ++domain) {
+        domains.push_back(domain);
+    }
+    for (uint64_t domain : {1023ull, 1024ull, 1025ull, 4096ull, 10007ull, 65536ull}) {
+        domains.push_back(domain);
+    }
+
+    bool ok = true;
+    for (uint64_t domain : domains) {
+        for (uint64_t seed : {0ull, 1ull, 0x5eedull}) {
+            speedy::KeyedPermutation permutation(domain, seed);
+            std::vector<char> seen(domain, 0);
+            for (uint64_t index = 0; index < domain; ++index) {
+                uint64_t image = permutation(index);
+                if (image >= domain || seen[image]) {
+                    std::cerr << "keyed permutation: domain " << domain << " seed " << seed << " maps " << index
+                              << " to " << (image >= domain ? "out of range " : "repeated ") << image << std::endl;
+                    ok = false;
+                    break;
+                }
+                seen[image] = 1;
+            }
+        }
+    }
+    return ok;
+}
+
+// The batch unranking entry points must refuse k > n rather than leave rows undefined.
+bool check_batch_shapes() {
+    std::vector<int> values = {5, 17, 1 << 20};
+    std::vector<int> rows(values.size() * 4);
+    speedy::LayerCache layer_cache(64);
+    speedy::PermutationCache permutation_cache(64);
+    bool ok = true;
+    auto expect_out_of_range = [&](const char* name, auto&& call) {
+        try {
+            call();
+            std::cerr << name << " accepted k > n" << std::endl;
+            ok = false;
+        } catch (const std::out_of_range&) {
+        }
+    };
+    expect_out_of_range("reverse_batch_permutations", [&] {
+        speedy::reverse_batch_permutations(3, 4, values.data(), values.size(), 8, rows.data());
+    });
+    expect_out_of_range("cached reverse_batch_permutations", [&] {
+        speedy::reverse_batch_permutations(3, 4, values.data(), values.size(), 8, rows.data(), layer_cache,
+                                           permutation_cache);
+    });
+    expect_out_of_range("packed reverse_batch_permutations", [&] {
+        speedy::PermutationArena arena(3, 4);
+        speedy::reverse_batch_permutations(values.data(), values.size(), 8, arena);
+    });
+    return ok;
+}
+
+// Decimal parsing into the exact tiers must reject values one past each word's maximum.
+bool check_exact_parsing() {
+    bool ok = true;
+    auto expect = [&](const char* name, bool passed) {
+        if (!passed) {
+            std::cerr << "exact parsing: " << name << std::endl;
+            ok = false;
+        }
+    };
+    auto overflows = [](auto zero, const std::string& text) {
+        try {
+            speedy::exact_from_string<decltype(zero)>(text);
+            return false;
+        } catch (const std::out_of_range&) {
+            return true;
+        }
+    };
+
+    expect("uint64 maximum", speedy::exact_from_string<uint64_t>("18446744073709551615") == ~uint64_t{0});
+    expect("uint64 maximum + 1", overflows(uint64_t{0}, "18446744073709551616"));
+    expect("uint64 wide overflow", overflows(uint64_t{0}, "99999999999999999999"));
+    unsigned __int128 max128 = ~static_cast<unsigned __int128>(0);
+    expect("uint128 maximum",
+           speedy::exact_from_string<unsigned __int128>("340282366920938463463374607431768211455") == max128);
+    expect("uint128 maximum + 1",
+           overflows(static_cast<unsigned __int128>(0), "340282366920938463463374607431768211456"));
+    speedy::ExactWide max_wide = speedy::ExactWide{} - speedy::ExactWide{1};
+    std::string wide_max = speedy::exact_to_string(max_wide);
+    expect("wide maximum", speedy::exact_from_string<speedy::ExactWide>(wide_max) == max_wide);
+    expect("wide overflow", overflows(speedy::ExactWide{}, wide_max + "0"));
+    return ok;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = check_unranking();
+    ok = check_keyed_permutation() && ok;
+    ok = check_batch_shapes() && ok;
+    ok = check_exact_parsing() && ok;
+    std::cout << (ok ? "All checks passed" : "Checks failed") << std::endl;
+    return ok ? 0 : 1;
+}